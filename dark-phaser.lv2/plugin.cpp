@@ -4,6 +4,7 @@
  *
  * Modifications were made so that we only include the phaser and do our own LV2 implementation.
  * Also the code was manually cleaned up and simplified, heavily reducing its size.
+ * A multiband variant was added, which only runs the phaser above a crossover split so the low end stays intact.
  */
 
 /* Calf DSP plugin pack
@@ -34,6 +35,8 @@
 #include <lv2/core/lv2_util.h>
 
 #include "control-port-state-update.h"
+#include "denormals.h"
+#include "dsp_load.h"
 
 #include <cstring>
 #include <cmath>
@@ -46,32 +49,46 @@
 namespace calf_plugins {
 
 static constexpr int kPhaserModuleDefaultStages = 6;
+static constexpr uint32_t kPhaserModuleBlockSize = 128;
+// samples between LFO updates, the allpass coefficient is interpolated in between
+// shorter is smoother but costs more, 8/16/32/64 are sensible choices
+static constexpr int kPhaserModuleControlInterval = 32;
+// split frequency of the multiband variant until the port is read
+static constexpr float kPhaserModuleDefaultSplit = 200.f;
 
 struct unused
 {
+    unused() = default;
+    // takes the constructor arguments of whatever it stands in for
+    template <class... Args>
+    explicit unused(Args&&...) {}
 };
 
-template <int io_count>
+// the multiband variant splits the input with a crossover and only runs the phaser above the split
+template <int io_count, bool multiband = false>
 struct phaser_metadata
 {
-    enum { param_on, par_reset, par_freq, par_depth, par_rate, par_fb, par_stages, par_stereo, param_count };
+    enum { param_on, par_reset, par_freq, par_depth, par_rate, par_fb, par_stages, par_stereo, par_split,
+           param_count = multiband ? par_split + 1 : par_split };
     enum { in_count = io_count, out_count = io_count };
 };
 
-template <int io_count>
-class phaser_audio_module: public audio_module<phaser_metadata<io_count>>
+template <int io_count, bool multiband = false>
+class phaser_audio_module: public audio_module<phaser_metadata<io_count, multiband>>
 {
-    static constexpr int param_on = phaser_metadata<io_count>::param_on;
-    static constexpr int par_reset = phaser_metadata<io_count>::par_reset;
-    static constexpr int par_freq = phaser_metadata<io_count>::par_freq;
-    static constexpr int par_depth = phaser_metadata<io_count>::par_depth;
-    static constexpr int par_rate = phaser_metadata<io_count>::par_rate;
-    static constexpr int par_fb = phaser_metadata<io_count>::par_fb;
-    static constexpr int par_stages = phaser_metadata<io_count>::par_stages;
-    static constexpr int par_stereo = phaser_metadata<io_count>::par_stereo;
+    using metadata = phaser_metadata<io_count, multiband>;
+    static constexpr int param_on = metadata::param_on;
+    static constexpr int par_reset = metadata::par_reset;
+    static constexpr int par_freq = metadata::par_freq;
+    static constexpr int par_depth = metadata::par_depth;
+    static constexpr int par_rate = metadata::par_rate;
+    static constexpr int par_fb = metadata::par_fb;
+    static constexpr int par_stages = metadata::par_stages;
+    static constexpr int par_stereo = metadata::par_stereo;
+    static constexpr int par_split = metadata::par_split;
 
 public:
-    enum { MaxStages = 12 };
+    enum { MaxStages = dsp::simple_phaser::MaxKernelStages };
     dsp::simple_phaser left;
     float x1vals[io_count][MaxStages];
     float y1vals[io_count][MaxStages];
@@ -84,6 +101,11 @@ public:
     dsp::inertia<dsp::linear_ramp> fb_compensationgain_ramp{dsp::linear_ramp(480)}; // 10ms at 48kHz
 
     std::conditional_t<io_count == 2, dsp::simple_phaser, unused> right;
+    // Linkwitz-Riley 24 dB/oct, the bands sum back to an allpass
+    std::conditional_t<multiband, dsp::crossover, unused> split;
+
+    darkglass::dsp_load_meter load_meter;
+    float* load_ports[2] = {};
 
 private:
     const LV2_Control_Port_State_Update* controlPortStateUpdate;
@@ -94,38 +116,62 @@ public:
 
     void params_changed() override {
         const auto &params = this->params;
+        const uint32_t changed = this->poll_params();
+        const bool do_reset = reset || *params[par_reset] >= 0.5f;
+
+        // nothing moved, nothing to recompute
+        if (changed == 0 && !do_reset)
+            return;
+
+        if (changed & (1u << par_fb)) {
+            // map [0..10] to [0.0..0.9]
+            float fb = 0.09f * (*params[par_fb]);
+            if (fb > 0.45f) {
+                // linearly from 0dB@0.45 to -6dB@0.9
+                fb_compensationgain = std::pow(10.f, (fb - 0.45f) / 0.45f * (-0.3f)); // -0.3f = 20*(-6)
+            } else {
+                fb_compensationgain = 1.f;
+            }
+            fb_compensationgain_ramp.set_inertia(fb_compensationgain);
+            fb_ramp.set_inertia(fb);
+        }
 
-        float rate = *params[par_rate]; // 0.01*pow(1000.0f,*params[par_rate]);
-        float base_frq = *params[par_freq];
-        float mod_depth = *params[par_depth];
-        // map [0..10] to [0.0..0.9]
-        float fb = 0.09f * (*params[par_fb]);
-        if (fb > 0.45f) {
-            // linearly from 0dB@0.45 to -6dB@0.9
-            fb_compensationgain = std::pow(10.f, (fb - 0.45f) / 0.45f * (-0.3f)); // -0.3f = 20*(-6)
-        } else {
-            fb_compensationgain = 1.f;
+        if (changed & (1u << par_stages)) {
+            int stages = (int)*params[par_stages];
+            if (stages != stage_switcher.get_state())
+                stage_switcher.set(stages);
         }
-        fb_compensationgain_ramp.set_inertia(fb_compensationgain);
-        int stages = (int)*params[par_stages];
-        float r_phase = *params[par_stereo] * (1.f / 360.f);
 
-        fb_ramp.set_inertia(fb);
-        if (stages != stage_switcher.get_state())
-            stage_switcher.set(stages);
+        if (changed & (1u << par_rate)) {
+            float rate = *params[par_rate]; // 0.01*pow(1000.0f,*params[par_rate]);
+            left.set_rate(rate);
+            if constexpr (io_count == 2)
+                right.set_rate(rate);
+        }
 
-        left.set_rate(rate);
-        left.set_base_frq(base_frq);
-        left.set_mod_depth(mod_depth);
+        if (changed & (1u << par_freq)) {
+            float base_frq = *params[par_freq];
+            left.set_base_frq(base_frq);
+            if constexpr (io_count == 2)
+                right.set_base_frq(base_frq);
+        }
 
-        if constexpr (io_count == 2) {
-            right.set_rate(rate);
-            right.set_base_frq(base_frq);
-            right.set_mod_depth(mod_depth);
+        if (changed & (1u << par_depth)) {
+            float mod_depth = *params[par_depth];
+            left.set_mod_depth(mod_depth);
+            if constexpr (io_count == 2)
+                right.set_mod_depth(mod_depth);
         }
 
-        if (reset || *params[par_reset] >= 0.5f) {
-            fb_ramp.set_now(fb);
+        if constexpr (multiband) {
+            if (changed & (1u << par_split))
+                split.set_filter(0, *params[par_split]);
+        }
+
+        float r_phase = *params[par_stereo] * (1.f / 360.f);
+
+        if (do_reset) {
+            fb_ramp.set_now(fb_ramp.old_value);
             fb_compensationgain_ramp.set_now(fb_compensationgain);
             stage_switcher.reset();
             left.reset();
@@ -135,7 +181,7 @@ public:
                 right.reset();
                 right.reset_phase(r_phase);
             }
-        } else {
+        } else if (changed & (1u << par_stereo)) {
             if constexpr (io_count == 2) {
                 if (std::fabs(r_phase - last_r_phase) > 0.0001f) {
                     right.phase = left.phase;
@@ -157,6 +203,9 @@ public:
             right.reset();
             right.reset_phase(last_r_phase);
         }
+
+        if constexpr (multiband)
+            split.reset();
     }
 
     void set_sample_rate(uint32_t sr) override {
@@ -164,6 +213,12 @@ public:
 
         if constexpr (io_count == 2)
             right.setup(sr);
+
+        if constexpr (multiband) {
+            split.init(io_count, 2, sr);
+            split.set_mode(1);
+            split.set_filter(0, kPhaserModuleDefaultSplit, true);
+        }
         
         fb_ramp.ramp.set_length(static_cast<int>(static_cast<float>(sr) * 0.01)); // 10ms
     }
@@ -181,59 +236,117 @@ public:
         const auto &ins = this->ins;
         const auto &params = this->params;
 
-        bypass.update(*params[param_on] < 0.5f, nsamples);
+        if (bypass.update(*params[param_on] < 0.5f, nsamples)) {
+            // fully bypassed, only keep the LFO and parameter ramps moving
+            fb_ramp.step_many(nsamples);
+            fb_compensationgain_ramp.step_many(nsamples);
+            stage_switcher.reset();
+            left.skip(nsamples);
+            if constexpr (io_count == 2)
+                right.skip(nsamples);
+            // like the phaser filter memory, the crossover state would only come back as a burst on re-engage
+            if constexpr (multiband)
+                split.reset();
+            bypass.crossfade(ins, outs, io_count, offset, nsamples);
+            return;
+        }
 
-        for (uint32_t i = 0; i < nsamples; ++i) {
-            float current_fb = fb_ramp.get();
-            float stage_switcher_amp = stage_switcher.get_ramp();
-            float fb_compensationgain_current = fb_compensationgain_ramp.get();
+        // while fading in or out of bypass the dry signal is needed after the output was written,
+        // which may be the same buffer as the input
+        const bool fading = bypass.fading();
+
+        float fb_buf[kPhaserModuleBlockSize];
+        float gain_buf[kPhaserModuleBlockSize];
+        int stages_buf[kPhaserModuleBlockSize];
+        float dry_buf[io_count][kPhaserModuleBlockSize];
+        // bands below and above the split
+        static constexpr uint32_t band_size = multiband ? kPhaserModuleBlockSize : 1;
+        float band_buf[2][io_count][band_size];
+
+        for (uint32_t i = 0; i < nsamples;) {
+            const uint32_t block = std::min(nsamples - i, kPhaserModuleBlockSize);
+
+            const float *dry[io_count];
+            float *wet[io_count];
+            const float *src[io_count];
+            for (int c = 0; c < io_count; ++c) {
+                wet[c] = outs[c] + offset + i;
+                dry[c] = dry_buf[c];
+                src[c] = ins[c] + offset + i;
+                if (fading)
+                    std::memcpy(dry_buf[c], ins[c] + offset + i, sizeof(float) * block);
+            }
 
-            left.set_fb(current_fb);
-            left.set_stages(stage_switcher.get_state());
-            left.process(outs[0] + offset + i, ins[0] + offset + i, 1, true);
-            outs[0][offset + i] *= stage_switcher_amp * fb_compensationgain_current;
+            // split before the phaser writes the output, which may be the input buffer
+            if constexpr (multiband) {
+                float *bands[2 * io_count];
+                for (int c = 0; c < io_count; ++c) {
+                    bands[c] = band_buf[0][c];
+                    bands[io_count + c] = band_buf[1][c];
+                }
+                split.process(src, bands, block);
+                for (int c = 0; c < io_count; ++c)
+                    src[c] = band_buf[1][c];
+            }
 
-            if constexpr (io_count == 2) {
-                right.set_fb(current_fb);
-                right.set_stages(stage_switcher.get_state());
-                right.process(outs[1] + offset + i, ins[1] + offset + i, 1, true);
-                outs[1][offset + i] *= stage_switcher_amp * fb_compensationgain_current;
+            // render the parameter ramps first, so the phaser can run over whole blocks
+            for (uint32_t j = 0; j < block; ++j) {
+                fb_buf[j] = fb_ramp.get();
+                gain_buf[j] = stage_switcher.get_ramp() * fb_compensationgain_ramp.get();
+                stages_buf[j] = stage_switcher.get_state();
             }
-        }
 
-        bypass.crossfade(ins, outs, io_count, offset, nsamples);
+            // split on stage count changes, which happen mid-fade while the output is silent
+            for (uint32_t j = 0; j < block;) {
+                uint32_t k = j + 1;
+                while (k < block && stages_buf[k] == stages_buf[j])
+                    ++k;
 
-    }
-};
+                left.set_stages(stages_buf[j]);
 
-template <>
-phaser_audio_module<1>::phaser_audio_module(const LV2_Control_Port_State_Update* controlPortStateUpdateInit)
-    : left(kPhaserModuleDefaultStages, x1vals[0], y1vals[0])
-{
-    controlPortStateUpdate = controlPortStateUpdateInit;
+                if constexpr (io_count == 2) {
+                    right.set_stages(stages_buf[j]);
+                    dsp::simple_phaser::process_stereo(left, right, wet[0] + j, wet[1] + j, src[0] + j, src[1] + j,
+                                                       k - j, fb_buf + j, gain_buf + j);
+                } else {
+                    left.process(wet[0] + j, src[0] + j, k - j, fb_buf + j, gain_buf + j);
+                }
 
-    left.set_dry(1.f);
-    left.set_wet(1.f);
-    left.set_lfo_active(false);
+                j = k;
+            }
 
-    stage_switcher.set(kPhaserModuleDefaultStages);
-    stage_switcher.reset();
-}
+            if constexpr (multiband) {
+                for (int c = 0; c < io_count; ++c)
+                    for (uint32_t j = 0; j < block; ++j)
+                        wet[c][j] += band_buf[0][c][j];
+            }
+
+            if (fading)
+                bypass.crossfade_part(dry, wet, io_count, i, block, nsamples);
 
-template <>
-phaser_audio_module<2>::phaser_audio_module(const LV2_Control_Port_State_Update* controlPortStateUpdateInit)
-    : left(kPhaserModuleDefaultStages, x1vals[0], y1vals[0])
-    , right(kPhaserModuleDefaultStages, x1vals[1], y1vals[1])
+            i += block;
+        }
+    }
+};
+
+template <int io_count, bool multiband>
+phaser_audio_module<io_count, multiband>::phaser_audio_module(const LV2_Control_Port_State_Update* controlPortStateUpdateInit)
+    : left(MaxStages, x1vals[0], y1vals[0])
+    , right(MaxStages, x1vals[io_count - 1], y1vals[io_count - 1])
 {
     controlPortStateUpdate = controlPortStateUpdateInit;
 
-    left.set_dry(1.f);
-    left.set_wet(1.f);
-    left.set_lfo_active(false);
+    const auto setup = [](dsp::simple_phaser& phaser) {
+        phaser.set_dry(1.f);
+        phaser.set_wet(1.f);
+        phaser.set_lfo_active(false);
+        phaser.set_control_interval(kPhaserModuleControlInterval);
+        phaser.set_sanitize(! darkglass::scoped_flush_denormals::effective);
+    };
 
-    right.set_dry(1.f);
-    right.set_wet(1.f);
-    right.set_lfo_active(false);
+    setup(left);
+    if constexpr (io_count == 2)
+        setup(right);
 
     stage_switcher.set(kPhaserModuleDefaultStages);
     stage_switcher.reset();
@@ -245,7 +358,7 @@ phaser_audio_module<2>::phaser_audio_module(const LV2_Control_Port_State_Update*
 
 using namespace calf_plugins;
 
-template <int io_count>
+template <int io_count, bool multiband = false>
 static LV2_Handle lv2_instantiate(const LV2_Descriptor*, double sampleRate, const char* uri, const LV2_Feature* const* const features)
 {
     const LV2_Control_Port_State_Update* controlPortStateUpdate = NULL;
@@ -254,51 +367,64 @@ static LV2_Handle lv2_instantiate(const LV2_Descriptor*, double sampleRate, cons
                        LV2_CONTROL_PORT_STATE_UPDATE_URI, &controlPortStateUpdate, false,
                        NULL);
 
-    auto plugin = new phaser_audio_module<io_count>(controlPortStateUpdate);
+    auto plugin = new phaser_audio_module<io_count, multiband>(controlPortStateUpdate);
     plugin->set_sample_rate(sampleRate);
+    plugin->load_meter.set_sample_rate(sampleRate);
     return plugin;
 }
 
-template <int io_count>
+template <int io_count, bool multiband = false>
 static void lv2_cleanup(LV2_Handle instance)
 {
-    delete static_cast<phaser_audio_module<io_count>*>(instance);
+    delete static_cast<phaser_audio_module<io_count, multiband>*>(instance);
 }
 
-template <int io_count>
+template <int io_count, bool multiband = false>
 static void lv2_connect_port(LV2_Handle instance, uint32_t port, void *data)
 {
-    auto plugin = static_cast<phaser_audio_module<io_count>*>(instance);
+    auto plugin = static_cast<phaser_audio_module<io_count, multiband>*>(instance);
 
-    if (port <= io_count) {
+    if (port < io_count) {
         plugin->ins[port] = static_cast<float*>(data);
         return;
     }
     port -= io_count;
 
-    if (port <= io_count) {
+    if (port < io_count) {
         plugin->outs[port] = static_cast<float*>(data);
         return;
     }
     port -= io_count;
 
-    if (port <= phaser_metadata<io_count>::param_count)
+    if (port < phaser_metadata<io_count, multiband>::param_count) {
         plugin->params[port] = static_cast<float*>(data);
+        return;
+    }
+    port -= phaser_metadata<io_count, multiband>::param_count;
+
+    // dsp load and peak
+    if (port < 2)
+        plugin->load_ports[port] = static_cast<float*>(data);
 }
 
-template <int io_count>
+template <int io_count, bool multiband = false>
 static void lv2_activate(LV2_Handle instance)
 {
-    auto plugin = static_cast<phaser_audio_module<io_count>*>(instance);
+    auto plugin = static_cast<phaser_audio_module<io_count, multiband>*>(instance);
     plugin->activate();
+    plugin->load_meter.reset();
 }
 
-template <int io_count>
+template <int io_count, bool multiband = false>
 static void lv2_run(LV2_Handle instance, uint32_t nsamples)
 {
-    auto plugin = static_cast<phaser_audio_module<io_count>*>(instance);
+    auto plugin = static_cast<phaser_audio_module<io_count, multiband>*>(instance);
+    // no per-sample denormal handling in the phaser where this flushes, see set_sanitize()
+    const darkglass::scoped_flush_denormals flush_denormals;
+    plugin->load_meter.begin();
     plugin->params_changed();
     plugin->process(0, nsamples);
+    plugin->load_meter.end(nsamples, plugin->load_ports[0], plugin->load_ports[1]);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -326,12 +452,24 @@ const LV2_Descriptor* lv2_descriptor(uint32_t index)
         .cleanup = lv2_cleanup<2>,
         .extension_data = nullptr
     };
+    static constexpr const LV2_Descriptor descriptorMultiband = {
+        .URI = "urn:darkglass:dark-phaser#multiband",
+        .instantiate = lv2_instantiate<1, true>,
+        .connect_port = lv2_connect_port<1, true>,
+        .activate = lv2_activate<1, true>,
+        .run = lv2_run<1, true>,
+        .deactivate = nullptr,
+        .cleanup = lv2_cleanup<1, true>,
+        .extension_data = nullptr
+    };
 
     switch (index) {
     case 0:
         return &descriptorMono;
     case 1:
         return &descriptorStereo;
+    case 2:
+        return &descriptorMultiband;
     default:
         return nullptr;
     }
@@ -7,6 +7,7 @@
  * Modifications were made so that it no longer depends on DPF for building, instead we do raw LV2 support directly.
  * The code also was manually cleaned up and simplified, heavily reducing its size.
  * Finally a few more tweaks for mono + stereo variants and hide some parameters.
+ * The kernel is templated on the channel count, for the mono, stereo, 4 and 8 channel variants.
  */
 
 /*******************************************************************************************************************
@@ -38,24 +39,35 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <lv2/core/lv2_util.h>
 
 #include "control-port-state-update.h"
+#include "denormals.h"
+#include "dsp_load.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 
+static constexpr int kTremoloBlockSize = 64;
+// time constant of the parameter smoothers, matches the 0.999 pole of the gen~ patch at 48 kHz
+static constexpr float kTremoloSmoothingMs = 20.8229f;
+
 // The State struct contains all the state and procedures for the gendsp kernel
+template <int Channels>
 struct State {
-	Phasor __m_phasor_10;
-	t_sample m_y_1;
+	static_assert(Channels >= 1 && Channels <= 8, "unsupported channel count");
+
+	PhasorI __m_phasor_10;
+	t_sample m_y[Channels];
 	t_sample m_phase_7;
 	t_sample m_tone_8;
+	t_sample m_tone_coef;
 	t_sample m_rate_9;
 	t_sample m_depth_6;
 	t_sample samples_to_seconds;
 	t_sample m_shape_5;
-	t_sample m_y_2;
-	t_sample m_smth_3;
-	t_sample m_smth_4;
-	t_sample m_smth_wet;
-	t_sample m_smth_depth;
+	Smooth<kTremoloBlockSize> m_smth_3;
+	Smooth<kTremoloBlockSize> m_smth_4;
+	Smooth<kTremoloBlockSize> m_smth_wet;
+	Smooth<kTremoloBlockSize> m_smth_depth;
 	t_sample wet;
     
 	const LV2_Control_Port_State_Update* controlPortStateUpdate;
@@ -67,11 +79,14 @@ struct State {
 
 	// re-initialize all member variables;
 	inline void reset(t_param __sr) {
-		m_y_1 = ((int)0);
-		m_y_2 = ((int)0);
-		m_smth_3 = ((int)0);
-		m_smth_4 = ((int)0);
-		m_smth_wet = ((int)0);
+		std::fill_n(m_y, Channels, 0.f);
+		m_smth_3.setup(kTremoloSmoothingMs, __sr);
+		m_smth_4.setup(kTremoloSmoothingMs, __sr);
+		m_smth_wet.setup(kTremoloSmoothingMs, __sr);
+		m_smth_depth.setup(kTremoloSmoothingMs, __sr);
+		m_smth_3.reset(0);
+		m_smth_4.reset(0);
+		m_smth_wet.reset(0);
 		m_shape_5 = ((t_sample)0.5);
 		m_depth_6 = ((int)100);
 		m_phase_7 = ((int)0);
@@ -80,198 +95,232 @@ struct State {
 		wet = 1;
 		samples_to_seconds = (1 / __sr);
 		__m_phasor_10.reset(0);
+		__m_phasor_10.freq(m_rate_9, samples_to_seconds);
+		update_tone_coef();
+	};
+	// tone split lowpass coefficient, depends on m_tone_8 and the sample rate only
+	inline void update_tone_coef() {
+		t_sample expr_1090 = (((m_tone_8 * ((int)2)) * ((t_sample)3.1415926535898)) * samples_to_seconds);
+		t_sample sin_24 = sin(expr_1090);
+		m_tone_coef = ((sin_24 <= ((t_sample)1e-05)) ? ((t_sample)1e-05) : ((sin_24 >= ((t_sample)0.99999)) ? ((t_sample)0.99999) : sin_24));
+	};
+	// fully bypassed once the wet smoother has settled, output is then the input as-is
+	inline bool bypassed() const {
+		return wet == 0 && m_smth_wet.converged;
+	};
+	// advance the LFO and smoothers by __n samples without rendering, see bypassed()
+	inline void skip(const t_sample * const * __ins, int __n) {
+		m_smth_depth.skip(__n);
+		m_smth_4.skip(__n);
+		m_smth_3.skip(__n);
+		__m_phasor_10.skip(__n);
+		// tone filter follows the input closely, start it from the last sample on re-engage
+		for (int c = 0; c < Channels; ++c)
+			m_y[c] = __ins[c][__n - 1];
+	};
+	// block kernel: the smoothers, phasor and gain terms are evaluated once for all channels, the
+	// triangle LFO and gain math run over plain arrays so they vectorise. The tone split recursions
+	// of all channels advance together, so they overlap instead of running one after the other.
+	// Channel c runs c / (Channels - 1) of the stereo phase behind channel 0.
+	inline void perform_block(const t_sample * const * __ins, t_sample * const * __outs, int __n) {
+		const t_sample clamp_25 = m_tone_coef;
+		alignas(32) t_sample depth[kTremoloBlockSize];
+		alignas(32) t_sample mix_amount[kTremoloBlockSize];
+		alignas(32) t_sample gain[kTremoloBlockSize];
+		alignas(32) t_sample shape[kTremoloBlockSize];
+		alignas(32) t_sample phase[kTremoloBlockSize];
+		alignas(32) t_sample wetness[kTremoloBlockSize];
+		alignas(32) t_sample lfo[kTremoloBlockSize];
+		alignas(32) t_sample tone[Channels][kTremoloBlockSize];
+		alignas(32) t_sample tri[kTremoloBlockSize];
+		for (int pos = 0; pos < __n; pos += kTremoloBlockSize) {
+			const int n = std::min(__n - pos, kTremoloBlockSize);
+			// the shape is nearly always settled, the triangle then needs no per-sample divisions
+			const bool shape_settled = m_smth_4.converged;
+			m_smth_depth.process(depth, n);
+			m_smth_4.process(shape, n);
+			m_smth_3.process(phase, n);
+			m_smth_wet.process(wetness, n);
+			__m_phasor_10.process(lfo, n);
+			for (int i = 0; i < n; ++i) {
+				mix_amount[i] = depth[i] * ((t_sample)0.01);
+				gain[i] = depth[i] * ((t_sample)0.005) + 1;
+			}
+			// tone split lowpass
+			t_sample y[Channels];
+			std::copy_n(m_y, Channels, y);
+			for (int i = 0; i < n; ++i) {
+				for (int c = 0; c < Channels; ++c) {
+					y[c] = y[c] + clamp_25 * (__ins[c][pos + i] - y[c]);
+					tone[c][i] = y[c];
+				}
+			}
+			std::copy_n(y, Channels, m_y);
+			const t_sample p1 = shape[0];
+			const t_sample rcp_p1 = 1 / p1;
+			const t_sample rcp_1_minus_p1 = 1 / (1 - p1);
+			for (int c = 0; c < Channels; ++c) {
+				const t_sample * const in = __ins[c] + pos;
+				t_sample * const out = __outs[c] + pos;
+				const t_sample offset = Channels > 1 ? (t_sample)c / (Channels - 1) : 0;
+				if (shape_settled) {
+					for (int i = 0; i < n; ++i)
+						tri[i] = trianglef_rcp(c == 0 ? lfo[i] : (phase[i] * offset + lfo[i]), p1, rcp_p1, rcp_1_minus_p1);
+				} else {
+					for (int i = 0; i < n; ++i)
+						tri[i] = trianglef(c == 0 ? lfo[i] : (phase[i] * offset + lfo[i]), shape[i]);
+				}
+				for (int i = 0; i < n; ++i) {
+					const t_sample in1 = in[i];
+					const t_sample trem = tone[c][i] * tri[i] + (in1 - tone[c][i]) * (1 - tri[i]);
+					const t_sample mix = in1 + mix_amount[i] * (trem - in1);
+					const t_sample out1 = mix * gain[i];
+					out[i] = out1 * wetness[i] + in1 * (1 - wetness[i]);
+				}
+			}
+		}
 	};
 	// the signal processing routine;
-	inline void perform_mono(const t_sample * __in1, t_sample * __out1, int __n) {
-		if (update_state && controlPortStateUpdate != NULL)
+	inline void perform(const t_sample * const * __ins, t_sample * const * __outs, int __n) {
+		// a single channel has no use for the stereo phase
+		if (Channels == 1 && update_state && controlPortStateUpdate != NULL)
         {
             controlPortStateUpdate->update_state(controlPortStateUpdate->handle,
-                                                 7,
+                                                 2 * Channels + 5,
                                                  LV2_CONTROL_PORT_STATE_INACTIVE);
             update_state = false;
         }
-		t_sample expr_1090 = (((m_tone_8 * ((int)2)) * ((t_sample)3.1415926535898)) * ((t_sample)2.0833333333333e-05));
-		t_sample expr_1089 = (((t_sample)0.0027777777777778) * m_phase_7);
-		t_sample wrap_3 = wrap(expr_1089, ((int)0), ((int)1));
-		t_sample sin_24 = sin(expr_1090);
-		t_sample clamp_25 = ((sin_24 <= ((t_sample)1e-05)) ? ((t_sample)1e-05) : ((sin_24 >= ((t_sample)0.99999)) ? ((t_sample)0.99999) : sin_24));
-		// the main sample loop;
-		while ((__n--)) {
-			const t_sample in1 = (*(__in1++));
-			m_smth_depth = (m_depth_6 + (((t_sample)0.999) * (m_smth_depth - m_depth_6)));
-			t_sample mul_15 = (m_smth_depth * ((t_sample)0.01));
-			t_sample mul_859 = (m_smth_depth * ((t_sample)0.005));
-			t_sample add_667 = (mul_859 + ((int)1));
-			t_sample mix_1 = (m_shape_5 + (((t_sample)0.999) * (m_smth_4 - m_shape_5)));
-			t_sample mix_2 = (wrap_3 + (((t_sample)0.999) * (m_smth_3 - wrap_3)));
-			t_sample mix_wet = (wet + (((t_sample)0.999) * (m_smth_wet - wet)));
-			t_sample mix_1062 = (m_y_2 + (clamp_25 * (in1 - m_y_2)));
-			t_sample sub_932 = (in1 - mix_1062);
-			t_sample phasor_6 = __m_phasor_10(m_rate_9, samples_to_seconds);
-			t_sample triangle_7 = triangle(phasor_6, mix_1);
-			t_sample mul_958 = (mix_1062 * triangle_7);
-			t_sample rsub_17 = (((int)1) - triangle_7);
-			t_sample mul_971 = (sub_932 * rsub_17);
-			t_sample add_984 = (mul_958 + mul_971);
-			t_sample mix_1129 = (in1 + (mul_15 * (add_984 - in1)));
-			t_sample out1 = (mix_1129 * add_667);
-			m_smth_4 = mix_1;
-			m_smth_3 = mix_2;
-			m_smth_wet = mix_wet;
-			m_y_2 = mix_1062;
-			// assign results to output buffer;
-			t_sample dry = 1.f - mix_wet;
-			(*(__out1++)) = out1 * mix_wet + in1 * dry;
-		}
-	};
-	inline void perform_stereo(const t_sample ** __ins, t_sample ** __outs, int __n) {
-		const t_sample * __in1 = __ins[0];
-		const t_sample * __in2 = __ins[1];
-		t_sample * __out1 = __outs[0];
-		t_sample * __out2 = __outs[1];
-		t_sample expr_1090 = (((m_tone_8 * ((int)2)) * ((t_sample)3.1415926535898)) * ((t_sample)2.0833333333333e-05));
-		t_sample expr_1089 = (((t_sample)0.0027777777777778) * m_phase_7);
-		t_sample wrap_3 = wrap(expr_1089, ((int)0), ((int)1));
-		t_sample sin_24 = sin(expr_1090);
-		t_sample clamp_25 = ((sin_24 <= ((t_sample)1e-05)) ? ((t_sample)1e-05) : ((sin_24 >= ((t_sample)0.99999)) ? ((t_sample)0.99999) : sin_24));
-		// the main sample loop;
-		while ((__n--)) {
-			const t_sample in1 = (*(__in1++));
-			const t_sample in2 = (*(__in2++));
-			m_smth_depth = (m_depth_6 + (((t_sample)0.999) * (m_smth_depth - m_depth_6)));
-			t_sample mul_15 = (m_smth_depth * ((t_sample)0.01));
-			t_sample mul_859 = (m_smth_depth * ((t_sample)0.005));
-			t_sample add_667 = (mul_859 + ((int)1));
-			t_sample mix_1 = (m_shape_5 + (((t_sample)0.999) * (m_smth_4 - m_shape_5)));
-			t_sample mix_2 = (wrap_3 + (((t_sample)0.999) * (m_smth_3 - wrap_3)));
-			t_sample mix_wet = (wet + (((t_sample)0.999) * (m_smth_wet - wet)));
-			t_sample mix_1062 = (m_y_2 + (clamp_25 * (in1 - m_y_2)));
-			t_sample mix_1049 = (m_y_1 + (clamp_25 * (in2 - m_y_1)));
-			t_sample sub_932 = (in1 - mix_1062);
-			t_sample sub_1036 = (in2 - mix_1049);
-			t_sample phasor_6 = __m_phasor_10(m_rate_9, samples_to_seconds);
-			t_sample triangle_7 = triangle(phasor_6, mix_1);
-			t_sample mul_958 = (mix_1062 * triangle_7);
-			t_sample rsub_17 = (((int)1) - triangle_7);
-			t_sample mul_971 = (sub_932 * rsub_17);
-			t_sample add_984 = (mul_958 + mul_971);
-			t_sample mix_1129 = (in1 + (mul_15 * (add_984 - in1)));
-			t_sample out1 = (mix_1129 * add_667);
-			t_sample triangle_5 = triangle((mix_2 + phasor_6), mix_1);
-			t_sample mul_1023 = (mix_1049 * triangle_5);
-			t_sample rsub_9 = (((int)1) - triangle_5);
-			t_sample mul_1010 = (sub_1036 * rsub_9);
-			t_sample add_997 = (mul_1023 + mul_1010);
-			t_sample mix_1130 = (in2 + (mul_15 * (add_997 - in2)));
-			t_sample out2 = (mix_1130 * add_667);
-			m_smth_4 = mix_1;
-			m_smth_3 = mix_2;
-			m_smth_wet = mix_wet;
-			m_y_2 = mix_1062;
-			m_y_1 = mix_1049;
-			// assign results to output buffer;
-			t_sample dry = 1.f - mix_wet;
-			(*(__out1++)) = out1 * mix_wet + in1 * dry;
-			(*(__out2++)) = out2 * mix_wet + in2 * dry;
+		if (bypassed()) {
+			if (__n > 0) {
+				skip(__ins, __n);
+				for (int c = 0; c < Channels; ++c)
+					if (__outs[c] != __ins[c])
+						std::memcpy(__outs[c], __ins[c], sizeof(t_sample) * __n);
+			}
+			return;
 		}
+		perform_block(__ins, __outs, __n);
 	};
 	inline void set_shape(t_param _value) {
 		m_shape_5 = (_value < 0.01 ? 0.01 : (_value > 0.99 ? 0.99 : _value));
+		m_smth_4.set(m_shape_5);
 	};
 	inline void set_depth(t_param _value) {
 		m_depth_6 = (_value < 0 ? 0 : (_value > 100 ? 100 : _value));
+		m_smth_depth.set(m_depth_6);
 	};
 	inline void set_phase(t_param _value) {
 		m_phase_7 = (_value < -180 ? -180 : (_value > 180 ? 180 : _value));
+		t_sample expr_1089 = (((t_sample)0.0027777777777778) * m_phase_7);
+		m_smth_3.set(wrapf(expr_1089, 0.f, 1.f));
 	};
 	inline void set_tone(t_param _value) {
 		m_tone_8 = (_value < 500 ? 500 : (_value > 6000 ? 6000 : _value));
+		update_tone_coef();
 	};
 	inline void set_rate(t_param _value) {
 		m_rate_9 = (_value < 0.1 ? 0.1 : (_value > 20 ? 20 : _value));
+		__m_phasor_10.freq(m_rate_9, samples_to_seconds);
 	};
-	// lv2 specific details
-	union {
-		struct {
-			const float* in[2];
-			float* out[2];
-			const float* ctrls[6];
-		} ports;
-		void* ptrs[11];
+	// lv2 specific details, ports are all inputs, then all outputs, then the controls, then dsp load and peak
+	struct {
+		const float* in[Channels];
+		float* out[Channels];
+		const float* ctrls[6];
+		float* load[2];
 	} lv2 = {};
+	darkglass::dsp_load_meter load_meter;
+	inline void lv2_connect_port(uint32_t port, void *data) {
+		if (port < Channels)
+			lv2.in[port] = static_cast<const float*>(data);
+		else if (port < 2 * Channels)
+			lv2.out[port - Channels] = static_cast<float*>(data);
+		else if (port < 2 * Channels + 6)
+			lv2.ctrls[port - 2 * Channels] = static_cast<const float*>(data);
+		else if (port < 2 * Channels + 8)
+			lv2.load[port - 2 * Channels - 6] = static_cast<float*>(data);
+	}
 	inline void lv2_reset() {
 		// memory reset
-		m_y_1 = ((int)0);
-		m_y_2 = ((int)0);
+		std::fill_n(m_y, Channels, 0.f);
 		__m_phasor_10.reset(0);
 		// set editable to targets -> skip any smoothing
-		m_smth_wet = wet;
-		m_smth_depth = m_depth_6;
-		m_smth_4 = m_shape_5;
+		m_smth_wet.reset(wet);
+		m_smth_depth.reset(m_depth_6);
+		m_smth_4.reset(m_shape_5);
 	}
 	inline void lv2_prerun() {
-		wet = *lv2.ports.ctrls[0] > 0.5f ? 1.f : 0.f;
-		set_rate(*lv2.ports.ctrls[2]);
+		wet = *lv2.ctrls[0] > 0.5f ? 1.f : 0.f;
+		m_smth_wet.set(wet);
+		set_rate(*lv2.ctrls[2]);
 		// map [0..10] to [0.1..0.9]
-		set_shape((*lv2.ports.ctrls[3]) * 0.08f + 0.1f);
-		set_depth(*lv2.ports.ctrls[4]);
-		set_phase(*lv2.ports.ctrls[5]);
+		set_shape((*lv2.ctrls[3]) * 0.08f + 0.1f);
+		set_depth(*lv2.ctrls[4]);
+		set_phase(*lv2.ctrls[5]);
 		// reset after parameter setting so that values jump directly to targets
-		if (*lv2.ports.ctrls[1] > 0.5f)
+		if (*lv2.ctrls[1] > 0.5f)
 			lv2_reset();
 	}
-	inline void lv2_run_mono(uint32_t nsamples) {
-		lv2_prerun();
-		perform_mono(lv2.ports.in[0], lv2.ports.out[0], nsamples);
-	}
-	inline void lv2_run_stereo(uint32_t nsamples) {
+	inline void lv2_run(uint32_t nsamples) {
+		// the tone filter and smoothers decay into denormals on silence
+		const darkglass::scoped_flush_denormals flush_denormals;
+		load_meter.begin();
 		lv2_prerun();
-		perform_stereo(lv2.ports.in, lv2.ports.out, nsamples);
+		perform(lv2.in, lv2.out, nsamples);
+		load_meter.end(nsamples, lv2.load[0], lv2.load[1]);
 	}
 };
 
 // --------------------------------------------------------------------------------------------------------------------
 
-static LV2_Handle lv2_instantiate(const LV2_Descriptor* desc, double sampleRate, const char*, const LV2_Feature* const* const features) {
+template <int Channels>
+static LV2_Handle lv2_instantiate(const LV2_Descriptor*, double sampleRate, const char*, const LV2_Feature* const* const features) {
     const LV2_Control_Port_State_Update* controlPortStateUpdate = NULL;
     lv2_features_query(features,
                        LV2_CONTROL_PORT_STATE_UPDATE_URI, &controlPortStateUpdate, false,
                        NULL);
-	auto plugin = new State(controlPortStateUpdate);
+	auto plugin = new State<Channels>(controlPortStateUpdate);
 	plugin->reset(sampleRate);
-	if (std::strcmp(desc->URI, "urn:darkglass:dark-tremolo#stereo") == 0)
+	plugin->load_meter.set_sample_rate(sampleRate);
+	if (Channels > 1)
 		plugin->m_phase_7 = 180;
 	return plugin;
 }
 
+template <int Channels>
 static void lv2_cleanup(LV2_Handle instance) {
-	delete static_cast<State*>(instance);
-}
-
-static void lv2_connect_port_mono(LV2_Handle instance, uint32_t port, void *data) {
-	uint32_t offset;
-	switch (port) {
-		case 0: offset = 0; break;
-		case 1: offset = 1; break;
-		default: offset = 2; break;
-	}
-	static_cast<State*>(instance)->lv2.ptrs[port + offset] = data;
+	delete static_cast<State<Channels>*>(instance);
 }
 
-static void lv2_connect_port_stereo(LV2_Handle instance, uint32_t port, void *data) {
-	static_cast<State*>(instance)->lv2.ptrs[port] = data;
+template <int Channels>
+static void lv2_connect_port(LV2_Handle instance, uint32_t port, void *data) {
+	static_cast<State<Channels>*>(instance)->lv2_connect_port(port, data);
 }
 
+template <int Channels>
 static void lv2_activate(LV2_Handle instance) {
-	static_cast<State*>(instance)->lv2_reset();
+	auto plugin = static_cast<State<Channels>*>(instance);
+	plugin->lv2_reset();
+	plugin->load_meter.reset();
 }
 
-static void lv2_run_mono(LV2_Handle instance, uint32_t nsamples) {
-	static_cast<State*>(instance)->lv2_run_mono(nsamples);
+template <int Channels>
+static void lv2_run(LV2_Handle instance, uint32_t nsamples) {
+	static_cast<State<Channels>*>(instance)->lv2_run(nsamples);
 }
 
-static void lv2_run_stereo(LV2_Handle instance, uint32_t nsamples) {
-	static_cast<State*>(instance)->lv2_run_stereo(nsamples);
+template <int Channels>
+static constexpr LV2_Descriptor lv2_make_descriptor(const char* uri) {
+	return {
+		.URI = uri,
+		.instantiate = lv2_instantiate<Channels>,
+		.connect_port = lv2_connect_port<Channels>,
+		.activate = lv2_activate<Channels>,
+		.run = lv2_run<Channels>,
+		.deactivate = nullptr,
+		.cleanup = lv2_cleanup<Channels>,
+		.extension_data = nullptr
+	};
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -279,32 +328,20 @@ static void lv2_run_stereo(LV2_Handle instance, uint32_t nsamples) {
 LV2_SYMBOL_EXPORT
 const LV2_Descriptor* lv2_descriptor(uint32_t index)
 {
-	static constexpr const LV2_Descriptor descriptorMono = {
-		.URI = "urn:darkglass:dark-tremolo",
-		.instantiate = lv2_instantiate,
-		.connect_port = lv2_connect_port_mono,
-		.activate = lv2_activate,
-		.run = lv2_run_mono,
-		.deactivate = nullptr,
-		.cleanup = lv2_cleanup,
-		.extension_data = nullptr
-	};
-	static constexpr const LV2_Descriptor descriptorStereo = {
-		.URI = "urn:darkglass:dark-tremolo#stereo",
-		.instantiate = lv2_instantiate,
-		.connect_port = lv2_connect_port_stereo,
-		.activate = lv2_activate,
-		.run = lv2_run_stereo,
-		.deactivate = nullptr,
-		.cleanup = lv2_cleanup,
-		.extension_data = nullptr
-	};
+	static constexpr const LV2_Descriptor descriptorMono = lv2_make_descriptor<1>("urn:darkglass:dark-tremolo");
+	static constexpr const LV2_Descriptor descriptorStereo = lv2_make_descriptor<2>("urn:darkglass:dark-tremolo#stereo");
+	static constexpr const LV2_Descriptor descriptorQuad = lv2_make_descriptor<4>("urn:darkglass:dark-tremolo#quad");
+	static constexpr const LV2_Descriptor descriptorOcto = lv2_make_descriptor<8>("urn:darkglass:dark-tremolo#octo");
 
 	switch (index) {
 	case 0:
 		return &descriptorMono;
 	case 1:
 		return &descriptorStereo;
+	case 2:
+		return &descriptorQuad;
+	case 3:
+		return &descriptorOcto;
 	default:
 		return nullptr;
 	}
@@ -29,8 +29,12 @@
 using namespace calf_plugins;
 using namespace dsp;
 
+bool allpass_coeff_table::initialized = false;
+float allpass_coeff_table::data[allpass_coeff_table::N + 1];
+
 simple_phaser::simple_phaser(int _max_stages, float *x1vals, float *y1vals)
 {
+    assert(_max_stages <= MaxKernelStages);
     max_stages = _max_stages;
     x1 = x1vals;
     y1 = y1vals;
@@ -40,6 +44,9 @@ simple_phaser::simple_phaser(int _max_stages, float *x1vals, float *y1vals)
     set_fb(0);
     state = 0;
     cnt = 0;
+    control_interval = 32;
+    a0_target = a0_inc = 0;
+    sanitizing = true;
     stages = 0;
     set_stages(_max_stages);
 }
@@ -51,13 +58,25 @@ void simple_phaser::set_stages(int _stages)
         assert(_stages <= max_stages);
         if (_stages > max_stages)
             _stages = max_stages;
+        // new stages start from the state of the last one, or silence when there is none yet
+        const float x = stages ? x1[stages-1] : 0.f;
+        const float y = stages ? y1[stages-1] : 0.f;
         for (int i = stages; i < _stages; i++)
         {
-            x1[i] = x1[stages-1];
-            y1[i] = y1[stages-1];
+            x1[i] = x;
+            y1[i] = y;
         }
     }
     stages = _stages;
+    kernel = kernels[stages];
+}
+
+void simple_phaser::set_control_interval(int interval)
+{
+    control_interval = std::max(interval, 1);
+    // make sure the next control step is not missed when shortening the interval
+    if (cnt > control_interval - 1)
+        cnt = control_interval - 1;
 }
 
 void simple_phaser::reset()
@@ -67,23 +86,42 @@ void simple_phaser::reset()
     phase.set(0);
     for (int i = 0; i < max_stages; i++)
         x1[i] = y1[i] = 0;
+    // start right at the current LFO position, there is nothing to interpolate from
+    a0_target = lfo_a0(phase);
     control_step();
 }
 
-void simple_phaser::control_step()
+float simple_phaser::lfo_a0(fixed_point<unsigned int, 20> lfo_phase) const
 {
-    cnt = 0;
-    int v = phase.get() + 0x40000000;
+    int v = lfo_phase.get() + 0x40000000;
     int sign = v >> 31;
     v ^= sign;
     // triangle wave, range from 0 to INT_MAX
-    double vf = (double)((v >> 16) * (1.0 / 16384.0) - 1);
+    float vf = (float)((v >> 16) * (1.0f / 16384.0f) - 1);
+
+    // freq = base_frq * 2^(vf * mod_depth / 1200), clipped to 10 Hz .. 0.49 * sr, straight to a0
+    float log2_freq = log2_base_frq + log2_odsr + vf * mod_depth_oct;
+    log2_freq = dsp::clip<float>(log2_freq, log2_min_frq, log2_max_frq);
+    return coeff_table.get(log2_freq);
+}
 
-    float freq = base_frq * pow(2.0, vf * mod_depth / 1200.0);
-    freq = dsp::clip<float>(freq, 10.0, 0.49 * sample_rate);
-    stage1.set_ap_w(freq * (M_PI / 2.0) * odsr);
+void simple_phaser::control_step_coeffs()
+{
+    // land exactly on the previous target, then ramp towards where the LFO will be
+    // at the end of this interval
+    stage1.set_ap_a0(a0_target);
     if (lfo_active)
-        phase += dphase * 32;
+        phase += dphase * control_interval;
+    a0_target = lfo_a0(phase);
+    a0_inc = (a0_target - stage1.a0) / control_interval;
+}
+
+void simple_phaser::control_step()
+{
+    cnt = 0;
+    control_step_coeffs();
+    if (!sanitizing)
+        return;
     for (int i = 0; i < stages; i++)
     {
         dsp::sanitize(x1[i]);
@@ -92,17 +130,35 @@ void simple_phaser::control_step()
     dsp::sanitize(state);
 }
 
+void simple_phaser::skip(int nsamples)
+{
+    gs_dry.step_many(nsamples);
+    gs_wet.step_many(nsamples);
+    if (lfo_active)
+        phase += dphase * nsamples;
+
+    // stale filter memory would only come back as a burst on re-engage
+    cnt = 0;
+    state = 0;
+    for (int i = 0; i < max_stages; i++)
+        x1[i] = y1[i] = 0;
+    a0_target = lfo_a0(phase);
+    stage1.set_ap_a0(a0_target);
+    a0_inc = 0;
+}
+
 void simple_phaser::process(float *buf_out, const float *buf_in, int nsamples, bool active)
 {
     for (int i=0; i<nsamples; i++) {
         cnt++;
-        if (cnt == 32)
+        if (cnt == control_interval)
             control_step();
         float in = *buf_in++;
         float fd = in + state * fb;
         for (int j = 0; j < stages; j++)
             fd = stage1.process_ap(fd, x1[j], y1[j]);
         state = fd;
+        stage1.a0 += a0_inc;
 
         float sdry = in * gs_dry.get();
         float swet = fd * gs_wet.get();
@@ -110,6 +166,205 @@ void simple_phaser::process(float *buf_out, const float *buf_in, int nsamples, b
     }
 }
 
+void simple_phaser::process(float *buf_out, const float *buf_in, int nsamples, const float *fb_ramp, const float *gain_ramp)
+{
+    (this->*kernel)(buf_out, buf_in, nsamples, fb_ramp, gain_ramp);
+}
+
+template<int Stages>
+void simple_phaser::process_block(float *buf_out, const float *buf_in, int nsamples, const float *fb_ramp, const float *gain_ramp)
+{
+    if (nsamples <= 0)
+        return;
+
+    // the whole cascade lives in locals, so it can stay in registers for the block
+    float sx1[Stages > 0 ? Stages : 1], sy1[Stages > 0 ? Stages : 1];
+    for (int j = 0; j < Stages; j++) {
+        sx1[j] = x1[j];
+        sy1[j] = y1[j];
+    }
+    float st = state;
+
+    while (nsamples > 0) {
+        // same control rate as the per-sample version, control_step() runs on every control_interval-th sample
+        if (cnt == control_interval - 1) {
+            // the filter state lives in the locals here, so sanitize those rather than the members
+            control_step_coeffs();
+            if (sanitizing) {
+                for (int j = 0; j < Stages; j++) {
+                    dsp::sanitize(sx1[j]);
+                    dsp::sanitize(sy1[j]);
+                }
+                dsp::sanitize(st);
+            }
+            cnt = -1;
+        }
+        const int seg = std::min(nsamples, control_interval - 1 - cnt);
+        cnt += seg;
+
+        float a0 = stage1.a0;
+        const float a0_step = a0_inc;
+        const bool ramping = gs_dry.active() || gs_wet.active();
+        float dry_amt = gs_dry.get_last();
+        float wet_amt = gs_wet.get_last();
+        for (int i = 0; i < seg; i++) {
+            const float in = buf_in[i];
+            float fd = in + st * fb_ramp[i];
+            for (int j = 0; j < Stages; j++) {
+                const float out = (fd - sy1[j]) * a0 + sx1[j];
+                sx1[j] = fd;
+                sy1[j] = out;
+                fd = out;
+            }
+            st = fd;
+            a0 += a0_step;
+
+            if (ramping) {
+                dry_amt = gs_dry.get();
+                wet_amt = gs_wet.get();
+            }
+            buf_out[i] = (in * dry_amt + fd * wet_amt) * gain_ramp[i];
+        }
+
+        stage1.a0 = a0;
+
+        buf_out += seg;
+        buf_in += seg;
+        fb_ramp += seg;
+        gain_ramp += seg;
+        nsamples -= seg;
+    }
+
+    for (int j = 0; j < Stages; j++) {
+        x1[j] = sx1[j];
+        y1[j] = sy1[j];
+    }
+    state = st;
+    fb = fb_ramp[-1];
+}
+
+template<int... Stages>
+static constexpr std::array<simple_phaser::block_kernel, sizeof...(Stages)> make_phaser_kernels(std::integer_sequence<int, Stages...>)
+{
+    return {{ &simple_phaser::process_block<Stages>... }};
+}
+
+const std::array<simple_phaser::block_kernel, simple_phaser::MaxKernelStages + 1> simple_phaser::kernels =
+    make_phaser_kernels(std::make_integer_sequence<int, simple_phaser::MaxKernelStages + 1>());
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+// two lanes (left, right) in a single SSE/NEON register
+typedef float phaser_v2sf __attribute__((vector_size(8)));
+
+static inline phaser_v2sf phaser_sanitize(phaser_v2sf v)
+{
+    return phaser_v2sf { dsp::_sanitize(v[0]), dsp::_sanitize(v[1]) };
+}
+
+template<int Stages>
+void simple_phaser::process_stereo_block(simple_phaser &left, simple_phaser &right, float *out_l, float *out_r,
+                                         const float *in_l, const float *in_r, int nsamples, const float *fb_ramp, const float *gain_ramp)
+{
+    if (nsamples <= 0)
+        return;
+
+    phaser_v2sf sx1[Stages > 0 ? Stages : 1], sy1[Stages > 0 ? Stages : 1];
+    for (int j = 0; j < Stages; j++) {
+        sx1[j] = phaser_v2sf { left.x1[j], right.x1[j] };
+        sy1[j] = phaser_v2sf { left.y1[j], right.y1[j] };
+    }
+    phaser_v2sf st = { left.state, right.state };
+
+    while (nsamples > 0) {
+        if (left.cnt == left.control_interval - 1) {
+            left.control_step_coeffs();
+            right.control_step_coeffs();
+            if (left.sanitizing) {
+                for (int j = 0; j < Stages; j++) {
+                    sx1[j] = phaser_sanitize(sx1[j]);
+                    sy1[j] = phaser_sanitize(sy1[j]);
+                }
+                st = phaser_sanitize(st);
+            }
+            left.cnt = right.cnt = -1;
+        }
+        const int seg = std::min(nsamples, left.control_interval - 1 - left.cnt);
+        left.cnt += seg;
+        right.cnt += seg;
+
+        phaser_v2sf a0 = { left.stage1.a0, right.stage1.a0 };
+        const phaser_v2sf a0_step = { left.a0_inc, right.a0_inc };
+        const bool ramping = left.gs_dry.active() || left.gs_wet.active();
+        float dry_amt = left.gs_dry.get_last();
+        float wet_amt = left.gs_wet.get_last();
+        for (int i = 0; i < seg; i++) {
+            const phaser_v2sf in = { in_l[i], in_r[i] };
+            phaser_v2sf fd = in + st * fb_ramp[i];
+            for (int j = 0; j < Stages; j++) {
+                const phaser_v2sf out = (fd - sy1[j]) * a0 + sx1[j];
+                sx1[j] = fd;
+                sy1[j] = out;
+                fd = out;
+            }
+            st = fd;
+            a0 += a0_step;
+
+            if (ramping) {
+                // both channels share the same dry/wet, keep the right one in step
+                dry_amt = left.gs_dry.get();
+                wet_amt = left.gs_wet.get();
+                right.gs_dry.get();
+                right.gs_wet.get();
+            }
+            const phaser_v2sf out = (in * dry_amt + fd * wet_amt) * gain_ramp[i];
+            out_l[i] = out[0];
+            out_r[i] = out[1];
+        }
+
+        left.stage1.a0 = a0[0];
+        right.stage1.a0 = a0[1];
+
+        out_l += seg;
+        out_r += seg;
+        in_l += seg;
+        in_r += seg;
+        fb_ramp += seg;
+        gain_ramp += seg;
+        nsamples -= seg;
+    }
+
+    for (int j = 0; j < Stages; j++) {
+        left.x1[j] = sx1[j][0]; right.x1[j] = sx1[j][1];
+        left.y1[j] = sy1[j][0]; right.y1[j] = sy1[j][1];
+    }
+    left.state = st[0];
+    right.state = st[1];
+    left.fb = right.fb = fb_ramp[-1];
+}
+
+template<int... Stages>
+static constexpr std::array<simple_phaser::stereo_block_kernel, sizeof...(Stages)> make_phaser_stereo_kernels(std::integer_sequence<int, Stages...>)
+{
+    return {{ &simple_phaser::process_stereo_block<Stages>... }};
+}
+
+const std::array<simple_phaser::stereo_block_kernel, simple_phaser::MaxKernelStages + 1> simple_phaser::stereo_kernels =
+    make_phaser_stereo_kernels(std::make_integer_sequence<int, simple_phaser::MaxKernelStages + 1>());
+#endif
+
+void simple_phaser::process_stereo(simple_phaser &left, simple_phaser &right, float *out_l, float *out_r,
+                                   const float *in_l, const float *in_r, int nsamples, const float *fb_ramp, const float *gain_ramp)
+{
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    assert(left.cnt == right.cnt && left.control_interval == right.control_interval && left.stages == right.stages
+           && left.sanitizing == right.sanitizing);
+    stereo_kernels[left.stages](left, right, out_l, out_r, in_l, in_r, nsamples, fb_ramp, gain_ramp);
+#else
+    left.process(out_l, in_l, nsamples, fb_ramp, gain_ramp);
+    right.process(out_r, in_r, nsamples, fb_ramp, gain_ramp);
+#endif
+}
+
 float simple_phaser::freq_gain(float freq, float sr) const
 {
     typedef std::complex<double> cfloat;
@@ -130,130 +385,61 @@ float simple_phaser::freq_gain(float freq, float sr) const
 
 void biquad_filter_module::calculate_filter(float freq, float q, int mode, float gain)
 {
+    dsp::biquad_coeffs coeffs;
     if (mode <= mode_36db_lp) {
         order = mode + 1;
-        left[0].set_lp_rbj(freq, pow(q, 1.0 / order), srate, gain);
+        coeffs.set_lp_rbj(freq, pow(q, 1.0 / order), srate, gain);
     } else if ( mode_12db_hp <= mode && mode <= mode_36db_hp ) {
         order = mode - mode_12db_hp + 1;
-        left[0].set_hp_rbj(freq, pow(q, 1.0 / order), srate, gain);
+        coeffs.set_hp_rbj(freq, pow(q, 1.0 / order), srate, gain);
     } else if ( mode_6db_bp <= mode && mode <= mode_18db_bp ) {
         order = mode - mode_6db_bp + 1;
-        left[0].set_bp_rbj(freq, pow(q, 1.0 / order), srate, gain);
+        coeffs.set_bp_rbj(freq, pow(q, 1.0 / order), srate, gain);
     } else if ( mode_6db_br <= mode && mode <= mode_18db_br) {
         order = mode - mode_6db_br + 1;
-        left[0].set_br_rbj(freq, order * 0.1 * q, srate, gain);
+        coeffs.set_br_rbj(freq, order * 0.1 * q, srate, gain);
     } else { // mode_allpass
         order = 3;
-        left[0].set_allpass(freq, 1, srate);
+        coeffs.set_allpass(freq, 1, srate);
     }
 
-    right[0].copy_coeffs(left[0]);
-    for (int i = 1; i < order; i++) {
-        left[i].copy_coeffs(left[0]);
-        right[i].copy_coeffs(left[0]);
-    }
+    filter.set_sections(order);
+    for (int i = 0; i < order; i++)
+        filter.set_coeffs(i, coeffs);
 }
 
 void biquad_filter_module::filter_activate()
 {
-    for (int i=0; i < order; i++) {
-        left[i].reset();
-        right[i].reset();
-    }
+    filter.reset();
 }
 
 void biquad_filter_module::sanitize()
 {
-    for (int i=0; i < order; i++) {
-        left[i].sanitize();
-        right[i].sanitize();
-    }
+    filter.sanitize();
 }
 
 int biquad_filter_module::process_channel(uint16_t channel_no, const float *in, float *out, uint32_t numsamples, int inmask, float lvl_in, float lvl_out) {
-    dsp::biquad_d1 *filter;
-    switch (channel_no) {
-    case 0:
-        filter = left;
-        break;
-
-    case 1:
-        filter = right;
-        break;
-
-    default:
+    if (channel_no > 1) {
         assert(false);
         return 0;
     }
 
-    if (inmask) {
-        switch(order) {
-            case 1:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[0].process(in[i] * lvl_in);
-                    out[i] *= lvl_out;
-                }
-                break;
-            case 2:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[1].process(filter[0].process(in[i] * lvl_in));
-                    out[i] *= lvl_out;
-                }
-                break;
-            case 3:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[2].process(filter[1].process(filter[0].process(in[i] * lvl_in)));
-                    out[i] *= lvl_out;
-                }
-                break;
-        }
-    } else {
-        if (filter[order - 1].empty())
-            return 0;
-        switch(order) {
-            case 1:
-                for (uint32_t i = 0; i < numsamples; i++) {
-                    out[i] = filter[0].process_zeroin();
-                    out[i] *= lvl_out;
-                }
-                break;
-            case 2:
-                if (filter[0].empty())
-                    for (uint32_t i = 0; i < numsamples; i++) {
-                        out[i] = filter[1].process_zeroin();
-                        out[i] *= lvl_out;
-                    }
-                else
-                    for (uint32_t i = 0; i < numsamples; i++) {
-                        out[i] = filter[1].process(filter[0].process_zeroin());
-                        out[i] *= lvl_out;
-                    }
-                break;
-            case 3:
-                if (filter[1].empty())
-                    for (uint32_t i = 0; i < numsamples; i++) {
-                        out[i] = filter[2].process_zeroin();
-                        out[i] *= lvl_out;
-                    }
-                else
-                    for (uint32_t i = 0; i < numsamples; i++) {
-                        out[i] = filter[2].process(filter[1].process(filter[0].process_zeroin()));
-                        out[i] *= lvl_out;
-                    }
-                break;
-        }
-    }
-    for (int i = 0; i < order; i++)
-        filter[i].sanitize();
-    return filter[order - 1].empty() ? 0 : inmask;
+    if (!inmask && filter.empty(channel_no))
+        return 0;
+    filter.process_channel(channel_no, inmask ? in : NULL, out, numsamples, lvl_in, lvl_out);
+    filter.sanitize(channel_no);
+    return filter.empty(channel_no) ? 0 : inmask;
+}
+
+void biquad_filter_module::process_stereo(const float *in_l, const float *in_r, float *out_l, float *out_r, uint32_t numsamples, float lvl_in, float lvl_out)
+{
+    filter.process_stereo(in_l, in_r, out_l, out_r, numsamples, lvl_in, lvl_out);
+    filter.sanitize();
 }
 
 float biquad_filter_module::freq_gain(int subindex, float freq, float srate) const
 {
-    float level = 1.0;
-    for (int j = 0; j < order; j++)
-        level *= left[j].freq_gain(freq, srate);
-    return level;
+    return filter.freq_gain(freq, srate);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -579,6 +765,7 @@ lookahead_limiter::lookahead_limiter() {
     use_multi = false;
     weight = 1.f;
     _sanitize = false;
+    fix_denormals = true;
     auto_release = false;
     asc_active = false;
     nextiter = 0;
@@ -591,12 +778,26 @@ lookahead_limiter::lookahead_limiter() {
     buffer = NULL;
     nextpos = NULL;
     nextdelta = NULL;
+    win_delay = NULL;
+    peak_gain = NULL;
+    peak_delta = NULL;
+    peak_time = NULL;
+    win_capacity = 0;
+    win_size = 1;
+    delay_pos = 0;
+    peak_head = 0;
+    peak_count = 0;
+    win_time = 0;
 }
 lookahead_limiter::~lookahead_limiter()
 {
     free(buffer);
     free(nextpos);
     free(nextdelta);
+    free(win_delay);
+    free(peak_gain);
+    free(peak_delta);
+    free(peak_time);
 }
 
 void lookahead_limiter::activate()
@@ -608,6 +809,8 @@ void lookahead_limiter::activate()
 
 void lookahead_limiter::set_multi(bool set) { use_multi = set; }
 
+void lookahead_limiter::set_fix_denormals(bool set) { fix_denormals = set; }
+
 void lookahead_limiter::deactivate()
 {
     is_active = false;
@@ -636,6 +839,18 @@ void lookahead_limiter::set_sample_rate(uint32_t sr)
     nextdelta = (float*) calloc(overall_buffer_size, sizeof(float));
     nextpos = (int*) malloc(overall_buffer_size * sizeof(int));
     memset(nextpos, -1, overall_buffer_size * sizeof(int));
+
+    free(win_delay);
+    free(peak_gain);
+    free(peak_delta);
+    free(peak_time);
+
+    // block engine, the same 100 ms of lookahead at most
+    win_capacity = overall_buffer_size / channels;
+    win_delay = (float*) calloc(win_capacity * channels, sizeof(float));
+    peak_gain = (float*) calloc(win_capacity, sizeof(float));
+    peak_delta = (float*) calloc(win_capacity, sizeof(float));
+    peak_time = (uint32_t*) calloc(win_capacity, sizeof(uint32_t));
     
     reset();
 }
@@ -662,6 +877,14 @@ void lookahead_limiter::reset() {
     delta = 0.f;
     att = 1.f;
     reset_asc();
+
+    // the block engine delays by one frame less than the window, like the frame engine
+    win_size = std::max(1, std::min(buffer_size / channels, win_capacity));
+    delay_pos = 0;
+    win_time = 0;
+    peak_head = 0;
+    peak_count = 0;
+    memset(win_delay, 0, win_capacity * channels * sizeof(float));
 }
 
 void lookahead_limiter::reset_asc() {
@@ -877,8 +1100,10 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
     }
 
     // post treatment (denormal, limit)
-    denormal(&left);
-    denormal(&right);
+    if (fix_denormals) {
+        denormal(&left);
+        denormal(&right);
+    }
 
     // store max attenuation for meter output
     att_max = (att < att_max) ? att : att_max;
@@ -892,6 +1117,140 @@ void lookahead_limiter::process(float &left, float &right, float * multi_buffer)
     asc_changed = false;
 }
 
+void lookahead_limiter::process(const float *const *ins, float *const *outs, uint32_t nsamples)
+{
+    enum { chunk_size = 64 };
+    float gains[chunk_size], delayed[2][chunk_size];
+    const int delay_len = win_size - 1;
+    const float _limit = limit * weight;
+    // ring indices only ever go one size past the end
+    const auto wrap = [](int i, int size) { return i >= size ? i - size : i; };
+    // slope from the stored peak j places from the front of the deque to the gain needed now
+    const auto slope_from = [&](int j, float needed) {
+        const int k = wrap(peak_head + j, win_capacity);
+        return (needed - peak_gain[k]) / (int)(win_time - peak_time[k]);
+    };
+
+    for (uint32_t done = 0; done < nsamples;) {
+        // stop at the end of the delay ring, so that it is read and written in one piece
+        uint32_t n = std::min<uint32_t>(nsamples - done, chunk_size);
+        if (delay_len)
+            n = std::min<uint32_t>(n, delay_len - delay_pos);
+        const float *in[2] = { ins[0] + done, ins[1] + done };
+        float *out[2] = { outs[0] + done, outs[1] + done };
+
+        // the outputs may be the inputs, everything is read before the outputs are written
+        for (int c = 0; c < 2; c++) {
+            if (delay_len) {
+                float *ring = win_delay + c * win_capacity + delay_pos;
+                memcpy(delayed[c], ring, n * sizeof(float));
+                memcpy(ring, in[c], n * sizeof(float));
+            } else {
+                memcpy(delayed[c], in[c], n * sizeof(float));
+            }
+        }
+        if (delay_len)
+            delay_pos = (delay_pos + n) % delay_len;
+
+        for (uint32_t i = 0; i < n; i++) {
+            const float peak = std::max(fabsf(in[0][i]), fabsf(in[1][i]));
+
+            if (auto_release && peak > _limit) {
+                asc += peak;
+                asc_c++;
+            }
+
+            if (peak > _limit) {
+                const float needed = _limit / peak;
+                const float rdelta = get_rdelta(peak, _limit, needed, false);
+                const float _delta = (needed - att) / win_size;
+                // how many stored peaks to keep before this one, -1 to leave it out
+                int keep = -1;
+                if (_delta < delta) {
+                    // steeper than the way we are going, start over from this peak
+                    keep = 0;
+                    delta = _delta;
+                } else if (peak_count) {
+                    // the frame engine stops at the first stored peak from which heading for this one is steeper
+                    // than its way on, that is a tail of the deque but for the release of the last one
+                    const auto steeper = [&](int j) {
+                        return slope_from(j, needed) < peak_delta[wrap(peak_head + j, win_capacity)];
+                    };
+                    if (peak_count > 1 && steeper(peak_count - 2)) {
+                        keep = peak_count - 1;
+                        while (keep > 1 && steeper(keep - 2))
+                            keep--;
+                    } else if (steeper(peak_count - 1)) {
+                        keep = peak_count;
+                    }
+                    if (keep > 0)
+                        peak_delta[wrap(peak_head + keep - 1, win_capacity)] = slope_from(keep - 1, needed);
+                }
+                if (keep >= 0) {
+                    const int back = wrap(peak_head + keep, win_capacity);
+                    peak_gain[back] = needed;
+                    peak_delta[back] = rdelta;
+                    peak_time[back] = win_time;
+                    peak_count = keep + 1;
+                }
+            }
+
+            // the sample going out now came in delay_len frames ago, it leaves the asc before the release is worked
+            // out, as in the frame engine
+            const float out_peak = std::max(fabsf(delayed[0][i]), fabsf(delayed[1][i]));
+            if (auto_release && out_peak > _limit) {
+                asc -= out_peak;
+                asc_c--;
+            }
+
+            att += delta;
+            // brickwall, for the rounding of the ramp
+            gains[i] = out_peak * att > _limit ? _limit / out_peak : att;
+
+            if (peak_count && peak_time[peak_head] + delay_len == win_time) {
+                // a stored peak goes out, head for the next one or release
+                if (auto_release) {
+                    delta = get_rdelta(out_peak, _limit, att);
+                    if (peak_count > 1) {
+                        const int k = wrap(peak_head + 1, win_capacity);
+                        const float next_delta = (peak_gain[k] - att) / (int)(peak_time[k] + delay_len - win_time);
+                        if (next_delta < delta)
+                            delta = next_delta;
+                    }
+                } else {
+                    delta = peak_delta[peak_head];
+                    att = _limit / out_peak;
+                }
+                peak_head = wrap(peak_head + 1, win_capacity);
+                peak_count--;
+            }
+
+            // released, or out of range, as in the frame engine
+            if (att > 1.f) {
+                att = 1.f;
+                delta = 0.f;
+                peak_count = 0;
+            }
+            if (att <= 0.f) {
+                att = 0.0000000000001;
+                delta = (1.0f - att) / (srate * release);
+            }
+            if (delta != 0.f && fabs(delta) < 0.00000000000001)
+                delta = 0.f;
+
+            att_max = std::min(att_max, att);
+            win_time++;
+        }
+
+        for (int c = 0; c < 2; c++) {
+            for (uint32_t i = 0; i < n; i++)
+                out[c][i] = delayed[c][i] * gains[i];
+        }
+
+        done += n;
+    }
+}
+
 bool lookahead_limiter::get_asc() {
     if(!asc_active) return false;
     asc_active = false;
@@ -1034,6 +1393,10 @@ crossover::crossover() {
     bands     = -1;
     mode      = -1;
     redraw_graph = 1;
+    group_count = 0;
+    stages    = 0;
+    lanes_dirty = true;
+    memset(groups, 0, sizeof(groups));
 }
 void crossover::set_sample_rate(uint32_t sr) {
     srate = sr;
@@ -1052,6 +1415,9 @@ void crossover::init(int c, int b, uint32_t sr) {
             out[c][b] = 0.f;
         }
     }
+    // the lane layout follows channels and bands, start from silence
+    memset(groups, 0, sizeof(groups));
+    lanes_dirty = true;
 }
 float crossover::set_filter(int b, float f, bool force) {
     // keep between neighbour bands
@@ -1103,6 +1469,7 @@ float crossover::set_filter(int b, float f, bool force) {
             hp[c][b][1].copy_coeffs(hp[c][b][0]);
         }
     }
+    lanes_dirty = true;
     redraw_graph = std::min(2, redraw_graph + 1);
     return freq[b];
 }
@@ -1110,6 +1477,7 @@ void crossover::set_mode(int m) {
     if(mode == m)
         return;
     mode = m;
+    lanes_dirty = true;
     for(int i = 0; i < bands - 1; i ++) {
         set_filter(i, freq[i], true);
     }
@@ -1125,29 +1493,136 @@ void crossover::set_level(int b, float l) {
     if (level[b] == l)
         return;
     level[b] = l;
+    lanes_dirty = true;
     redraw_graph = std::min(2, redraw_graph + 1);
 }
 void crossover::process(float *data) {
+    const float *ins[8];
+    float *outs[64];
     for (int c = 0; c < channels; c++) {
-        for(int b = 0; b < bands; b ++) {
-            out[c][b] = data[c];
-            for (int f = 0; f < get_filter_count(); f++){
-                if(b + 1 < bands) {
-                    out[c][b] = lp[c][b][f].process(out[c][b]);
-                    lp[c][b][f].sanitize();
-                }
-                if(b - 1 >= 0) {
-                    out[c][b] = hp[c][b - 1][f].process(out[c][b]);
-                    hp[c][b - 1][f].sanitize();
-                }
+        ins[c] = &data[c];
+        for (int b = 0; b < bands; b++)
+            outs[b * channels + c] = &out[c][b];
+    }
+    process(ins, outs, 1);
+}
+void crossover::update_lanes() {
+    const int filters = get_filter_count();
+    // with two bands each one has only its lowpass or its highpass
+    stages = bands > 2 ? 2 * filters : bands == 2 ? filters : 0;
+    const int lanes = channels * bands;
+    group_count = (lanes + 3) / 4;
+    for (int l = 0; l < group_count * 4; l++) {
+        lane_group &g = groups[l / 4];
+        const int k = l % 4;
+        const bool used = l < lanes;
+        const int c = used ? l / bands : 0;
+        const int b = used ? l % bands : 0;
+        g.channel[k] = c;
+        g.band[k] = b;
+        g.level[k] = used ? level[b] : 0.f;
+        for (int s = 0; s < max_stages; s++) {
+            // pass-through unless the band has a filter in this stage
+            dsp::biquad_coeffs coeffs;
+            if (used && s < stages) {
+                if (bands == 2)
+                    coeffs.copy_coeffs(b ? hp[0][0][s] : lp[0][0][s]);
+                else if (s % 2 == 0 && b + 1 < bands)
+                    coeffs.copy_coeffs(lp[0][b][s / 2]);
+                else if (s % 2 == 1 && b > 0)
+                    coeffs.copy_coeffs(hp[0][b - 1][s / 2]);
             }
-            out[c][b] *= level[b];
+            g.a0[s][k] = coeffs.a0;
+            g.a1[s][k] = coeffs.a1;
+            g.a2[s][k] = coeffs.a2;
+            g.b1[s][k] = coeffs.b1;
+            g.b2[s][k] = coeffs.b2;
+        }
+    }
+    for (int i = 0; i < group_count; i++)
+        groups[i].used = std::min(4, lanes - i * 4);
+    lanes_dirty = false;
+}
+typedef double crossover_v4df __attribute__((vector_size(32)));
+
+template<int Stages>
+void crossover::process_group(lane_group &g, const float *const *ins, float *const *outs, uint32_t nsamples) {
+    enum { size = Stages ? Stages : 1 };
+    // locals, so that the stores to the outputs cannot alias the coefficients and the state
+    crossover_v4df a0[size], a1[size], a2[size], b1[size], b2[size], w1[size], w2[size], lvl;
+    for (int s = 0; s < Stages; s++) {
+        memcpy(&a0[s], g.a0[s], sizeof(a0[s]));
+        memcpy(&a1[s], g.a1[s], sizeof(a1[s]));
+        memcpy(&a2[s], g.a2[s], sizeof(a2[s]));
+        memcpy(&b1[s], g.b1[s], sizeof(b1[s]));
+        memcpy(&b2[s], g.b2[s], sizeof(b2[s]));
+        memcpy(&w1[s], g.s1[s], sizeof(w1[s]));
+        memcpy(&w2[s], g.s2[s], sizeof(w2[s]));
+    }
+    memcpy(&lvl, g.level, sizeof(lvl));
+    const int used = g.used;
+    const float *in[4];
+    float *dst[4];
+    for (int k = 0; k < 4; k++) {
+        in[k] = ins[g.channel[k]];
+        dst[k] = k < used ? outs[g.band[k] * channels + g.channel[k]] : NULL;
+    }
+    for (uint32_t i = 0; i < nsamples; i++) {
+        crossover_v4df x = { in[0][i], in[1][i], in[2][i], in[3][i] };
+        for (int s = 0; s < Stages; s++) {
+            const crossover_v4df y = a0[s] * x + w1[s];
+            w1[s] = a1[s] * x - b1[s] * y + w2[s];
+            w2[s] = a2[s] * x - b2[s] * y;
+            x = y;
+        }
+        x *= lvl;
+        for (int k = 0; k < used; k++)
+            dst[k][i] = x[k];
+    }
+    for (int s = 0; s < Stages; s++) {
+        memcpy(g.s1[s], &w1[s], sizeof(w1[s]));
+        memcpy(g.s2[s], &w2[s], sizeof(w2[s]));
+    }
+    // transposed state passes close to zero all the time, so a lane is only cleared once all of it has decayed
+    for (int k = 0; k < 4; k++) {
+        bool silent = true;
+        for (int s = 0; s < Stages; s++)
+            silent = silent && dsp::_sanitize(g.s1[s][k]) == 0 && dsp::_sanitize(g.s2[s][k]) == 0;
+        if (silent) {
+            for (int s = 0; s < Stages; s++)
+                g.s1[s][k] = g.s2[s][k] = 0;
         }
     }
 }
+void crossover::process(const float *const *ins, float *const *outs, uint32_t nsamples) {
+    if (lanes_dirty)
+        update_lanes();
+    for (int i = 0; i < group_count; i++) {
+        switch (stages) {
+            case 0: process_group<0>(groups[i], ins, outs, nsamples); break;
+            case 1: process_group<1>(groups[i], ins, outs, nsamples); break;
+            case 2: process_group<2>(groups[i], ins, outs, nsamples); break;
+            case 4: process_group<4>(groups[i], ins, outs, nsamples); break;
+            case 8: process_group<8>(groups[i], ins, outs, nsamples); break;
+        }
+    }
+    if (nsamples) {
+        for (int c = 0; c < channels; c++)
+            for (int b = 0; b < bands; b++)
+                out[c][b] = outs[b * channels + c][nsamples - 1];
+    }
+}
 float crossover::get_value(int c, int b) {
     return out[c][b];
 }
+void crossover::reset() {
+    // init() clears the groups past the ones in use
+    for (int i = 0; i < group_count; i++) {
+        memset(groups[i].s1, 0, sizeof(groups[i].s1));
+        memset(groups[i].s2, 0, sizeof(groups[i].s2));
+    }
+    memset(out, 0, sizeof(out));
+}
 int crossover::get_filter_count() const
 {
     switch (mode) {
@@ -27,7 +27,9 @@
 #include "inertia.h"
 #include "giface.h"
 #include "onepole.h"
+#include <array>
 #include <complex>
+#include <utility>
 
 namespace calf_plugins {
     struct cairo_iface;
@@ -101,18 +103,66 @@ public:
     }
 };
 
+/**
+ * Allpass coefficient a0 = (tan(w) - 1) / (tan(w) + 1) = tan(w - pi/4), w = (pi/2) * f / sr,
+ * tabulated against log2(f / sr) so that an exponential sweep is a straight walk through the table.
+ * Linear interpolation over [-16, -1] (10 Hz at 192 kHz up to 0.49 * sr) stays within 1.1e-5
+ * of the exact a0, which moves the pole by at most 0.56 cents; the float tan() path it
+ * replaces is off by up to 0.77 cents, both being dominated by float rounding of a0 near -1.
+ */
+class allpass_coeff_table
+{
+public:
+    enum { N = 1024 };
+    static constexpr float min_log2 = -16.f, max_log2 = -1.f;
+    static bool initialized;
+    static float data[N + 1];
+    allpass_coeff_table() {
+        if (initialized)
+            return;
+        initialized = true;
+        for (int i = 0; i < N + 1; i++)
+            data[i] = (float)tan(M_PI / 2 * exp2(min_log2 + (max_log2 - min_log2) * i / N) - M_PI / 4);
+    }
+    /// a0 for a frequency of 2^log2_ratio * sr, log2_ratio must be within [min_log2, max_log2]
+    static inline float get(float log2_ratio) {
+        float pos = (log2_ratio - min_log2) * (N / (max_log2 - min_log2));
+        int i = std::min((int)pos, N - 1);
+        float frac = pos - i;
+        return data[i] + frac * (data[i + 1] - data[i]);
+    }
+};
+
 /**
  * A monophonic phaser. If you want stereo, combine two :)
  * Also, gave up on using template args for signal type.
  */
 class simple_phaser: public modulation_effect
 {
+public:
+    /// Largest stage count with a specialised block kernel
+    enum { MaxKernelStages = 12 };
+    typedef void (simple_phaser::*block_kernel)(float *, const float *, int, const float *, const float *);
+    typedef void (*stereo_block_kernel)(simple_phaser &, simple_phaser &, float *, float *, const float *, const float *, int,
+                                        const float *, const float *);
 protected:
     float base_frq, mod_depth, fb;
+    // sweep in log2(frequency / sr) units, see allpass_coeff_table
+    float log2_base_frq, mod_depth_oct, log2_odsr, log2_min_frq, log2_max_frq;
+    allpass_coeff_table coeff_table;
     float state;
-    int cnt, stages, max_stages;
+    int cnt, control_interval, stages, max_stages;
+    // a0 is interpolated linearly per sample between control steps
+    float a0_target, a0_inc;
     dsp::onepole<float, float> stage1;
     float *x1, *y1;
+    block_kernel kernel;
+    bool sanitizing;
+    float lfo_a0(fixed_point<unsigned int, 20> lfo_phase) const;
+    /// LFO and coefficient part of control_step(), for the block kernels which keep the filter state in locals
+    void control_step_coeffs();
+    static const std::array<block_kernel, MaxKernelStages + 1> kernels;
+    static const std::array<stereo_block_kernel, MaxKernelStages + 1> stereo_kernels;
 public:
     simple_phaser(int _max_stages, float *x1vals, float *y1vals);
 
@@ -121,17 +171,29 @@ public:
     }
     void set_base_frq(float _base_frq) {
         base_frq = _base_frq;
+        log2_base_frq = log2f(base_frq);
     }
     int get_stages() const {
         return stages;
     }
     void set_stages(int _stages);
+    int get_control_interval() const {
+        return control_interval;
+    }
+    /// Set the number of samples between LFO/coefficient updates (default 32)
+    void set_control_interval(int interval);
+    /// Flush tiny filter state to zero on every control step (default on), only safe to turn off when
+    /// processing with flush-to-zero enabled, see darkglass::scoped_flush_denormals
+    void set_sanitize(bool enable) {
+        sanitizing = enable;
+    }
 
     float get_mod_depth() const {
         return mod_depth;
     }
     void set_mod_depth(float _mod_depth) {
         mod_depth = _mod_depth;
+        mod_depth_oct = mod_depth * (1.f / 1200.f);
     }
 
     float get_fb() const {
@@ -143,11 +205,29 @@ public:
     
     virtual void setup(int sample_rate) {
         modulation_effect::setup(sample_rate);
+        log2_odsr = -log2f(sample_rate);
+        log2_min_frq = std::max(log2f(10.f) + log2_odsr, allpass_coeff_table::min_log2);
+        log2_max_frq = log2f(0.49f);
         reset();
     }
     void reset();
     void control_step();
+    /// Keep the LFO running for nsamples without producing output, the filter memory is cleared
+    void skip(int nsamples);
     void process(float *buf_out, const float *buf_in, int nsamples, bool active);
+    /// Process a block with per-sample feedback and output gain ramps, the stage count must stay constant
+    void process(float *buf_out, const float *buf_in, int nsamples, const float *fb_ramp, const float *gain_ramp);
+    /// Block kernel with the stage count fixed at compile time, see kernels
+    template<int Stages>
+    void process_block(float *buf_out, const float *buf_in, int nsamples, const float *fb_ramp, const float *gain_ramp);
+    /// Process a pair of phasers running in lockstep (same stage count, control counter and dry/wet),
+    /// running both channels through the allpass cascade together
+    static void process_stereo(simple_phaser &left, simple_phaser &right, float *out_l, float *out_r,
+                               const float *in_l, const float *in_r, int nsamples, const float *fb_ramp, const float *gain_ramp);
+    /// Stereo kernel with the stage count fixed at compile time, see stereo_kernels
+    template<int Stages>
+    static void process_stereo_block(simple_phaser &left, simple_phaser &right, float *out_l, float *out_r,
+                                     const float *in_l, const float *in_r, int nsamples, const float *fb_ramp, const float *gain_ramp);
     float freq_gain(float freq, float sr) const;
 };
 
@@ -452,7 +532,8 @@ public:
 class biquad_filter_module: public filter_module_iface
 {
 private:
-    dsp::biquad_d1 left[3], right[3];
+    /// both channels, they share the coefficients, double like the biquad_d1 chain this replaces
+    dsp::biquad_tdf2_cascade<double, 3> filter;
     int order;
 
 public:
@@ -477,6 +558,8 @@ public:
     void sanitize();
     /// Process a single channel (float buffer) of data
     int process_channel(uint16_t channel_no, const float *in, float *out, uint32_t numsamples, int inmask, float lvl_in = 1., float lvl_out = 1.);
+    /// Process both channels at once, faster than two process_channel calls
+    void process_stereo(const float *in_l, const float *in_r, float *out_l, float *out_r, uint32_t numsamples, float lvl_in = 1., float lvl_out = 1.);
     /// Determine gain (|H(z)|) for a given frequency
     float freq_gain(int subindex, float freq, float srate) const;
 };
@@ -585,6 +668,18 @@ public:
     bool asc_changed;
     float asc_coeff;
     bool _asc_used;
+    /// round tiny output values to zero with denormal() (default on), not needed with flush-to-zero enabled
+    bool fix_denormals;
+    /// State of the block engine, separate from the one of the frame engine but for att, delta and asc, an instance
+    /// uses one or the other. It follows the frame engine sample by sample, the peaks it heads for are a deque whose
+    /// slopes only rise (but for the release of the last one), so a new peak drops the ones it overrides from the back
+    /// instead of walking the list from the front. Amortised constant work per sample whatever the attack time.
+    float *win_delay;           ///< delayed input, one ring per channel
+    float *peak_gain;           ///< deque of the gains the stored peaks need...
+    float *peak_delta;          ///< ...the slope from each to the next, the release from the last one...
+    uint32_t *peak_time;        ///< ...and the times they came in
+    int win_capacity, win_size, delay_pos, peak_head, peak_count;
+    uint32_t win_time;
     static inline void denormal(volatile float *f) {
         *f += 1e-18;
         *f -= 1e-18;
@@ -596,7 +691,10 @@ public:
     lookahead_limiter();
     ~lookahead_limiter();
     void set_multi(bool set);
+    void set_fix_denormals(bool set);
     void process(float &left, float &right, float *multi_buffer);
+    /// Process a block of stereo audio with the block engine, in-place allowed. No multiband coefficient.
+    void process(const float *const *ins, float *const *outs, uint32_t nsamples);
     void set_sample_rate(uint32_t sr);
     void set_params(float l, float a, float r, float weight = 1.f, bool ar = false, float arc = 1.f, bool d = false);
     float get_attenuation();
@@ -631,15 +729,40 @@ public:
 
 class crossover {
 private:
+    enum { max_stages = 8, max_groups = 16 };
+    /// Four (channel, band) lanes, each runs the filter chain of its band on the input of its channel.
+    /// Bands without a lowpass or highpass get pass-through sections, so all lanes have the same length.
+    /// Double precision like biquad_d2, float state is too noisy for splits in the bass range.
+    /// Stored as plain arrays, the block kernel copies them into vectors.
+    struct lane_group {
+        double a0[max_stages][4], a1[max_stages][4], a2[max_stages][4], b1[max_stages][4], b2[max_stages][4];
+        double s1[max_stages][4], s2[max_stages][4];
+        double level[4];
+        int channel[4], band[4];
+        int used;
+    };
+    lane_group groups[max_groups];
+    int group_count, stages;
+    bool lanes_dirty;
+    void update_lanes();
+    template<int Stages>
+    void process_group(lane_group &g, const float *const *ins, float *const *outs, uint32_t nsamples);
 public:
     int channels, bands, mode;
     float freq[8], active[8], level[8], out[8][8];
+    /// filter coefficients, the state lives in the lane groups
     dsp::biquad_d2 lp[8][8][4], hp[8][8][4];
     mutable int redraw_graph;
     uint32_t srate;
     crossover();
+    /// Process one interleaved frame, the results are read with get_value
     void process(float *data);
+    /// Process a block, ins[c] is the input of channel c and outs[b * channels + c] the output of band b for it.
+    /// Outputs must not overlap the inputs.
+    void process(const float *const *ins, float *const *outs, uint32_t nsamples);
     float get_value(int c, int b);
+    /// Clear the filter state, keeping the settings
+    void reset();
     void set_sample_rate(uint32_t sr);
     float set_filter(int b, float f, bool force = false);
     void set_level(int b, float l);
@@ -27,6 +27,31 @@ public:
         return first_value >= 1 && next_value >= 1;
     }
     
+    /// Is the output going to be a mix of dry and processed signal for the block passed to update()?
+    bool fading() const
+    {
+        return (first_value + next_value) != 0 && !(first_value >= 1 && next_value >= 1);
+    }
+
+    /// Apply ramp to samples [start, start + count) of the nsamples passed to update(), with inputs
+    /// and outputs pointing at sample start; inputs must not alias outputs while fading
+    void crossfade_part(const float *const *inputs, float *const *outputs, uint32_t nbuffers, uint32_t start, uint32_t count, uint32_t nsamples)
+    {
+        if (!fading() || !count)
+            return;
+        float step = (next_value - first_value) / nsamples;
+        for (uint32_t b = 0; b < nbuffers; ++b)
+        {
+            float *out = outputs[b];
+            const float *in = inputs[b];
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                float bypass_amt = first_value + (start + i) * step;
+                out[i] += (in[i] - out[i]) * bypass_amt;
+            }
+        }
+    }
+
     /// Apply ramp to prevent clicking
     void crossfade(const float *const *inputs, float *const *outputs, uint32_t nbuffers, uint32_t offset, uint32_t nsamples)
     {
@@ -37,8 +62,11 @@ public:
         {
             float *out = outputs[b] + offset;
             const float *in = inputs[b] + offset;
-            if (first_value >= 1 && next_value >= 1)
-                memcpy(out, in, nsamples * sizeof(float));
+            if (first_value >= 1 && next_value >= 1) {
+                // fully bypassed, nothing to do when processing in-place
+                if (out != in)
+                    memcpy(out, in, nsamples * sizeof(float));
+            }
             else
             {
                 for (uint32_t i = 0; i < nsamples; ++i)
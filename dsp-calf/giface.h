@@ -64,11 +64,17 @@ public:
     const float *ins[(Metadata::in_count != 0)  ? Metadata::in_count : 1];
     float *outs[(Metadata::out_count != 0) ? Metadata::out_count : 1];
     const float *params[Metadata::param_count];
+    /// Parameter values as of the last poll_params() call
+    float params_cache[Metadata::param_count];
+    bool params_cache_valid = false;
+
+    static_assert(Metadata::param_count <= 32, "poll_params() reports changes as a 32-bit mask");
 
     audio_module() {
         memset(ins, 0, sizeof(ins));
         memset(outs, 0, sizeof(outs));
         memset(params, 0, sizeof(params));
+        memset(params_cache, 0, sizeof(params_cache));
     }
 
     /// Called when params are changed (before processing)
@@ -86,6 +92,21 @@ public:
         outs_ptrs = outs;
         params_ptrs = params;
     }
+    /// utility function: snapshot the parameter ports, returns a mask with bit N set if params[N] changed since the last call
+    uint32_t poll_params()
+    {
+        // the first poll reports every parameter as changed
+        uint32_t changed = 0;
+        for (int i = 0; i < Metadata::param_count; i++) {
+            const float value = *params[i];
+            if (!params_cache_valid || value != params_cache[i]) {
+                params_cache[i] = value;
+                changed |= 1u << i;
+            }
+        }
+        params_cache_valid = true;
+        return changed;
+    }
     /// utility function: call process, and if it returned zeros in output masks, zero out the relevant output port buffers
     void process_slice(uint32_t offset, uint32_t end)
     {
@@ -78,6 +78,13 @@ public:
         a1 = 1;
     }
     
+    /// Set coefficients for an allpass filter from a precomputed a0 = (tan(w) - 1) / (tan(w) + 1)
+    void set_ap_a0(Coeff _a0)
+    {
+        b1 = a0 = _a0;
+        a1 = 1;
+    }
+    
     /// Set coefficients for a highpass filter
     void set_hp(float fc, float sr)
     {
@@ -0,0 +1,77 @@
+/*
+ * Denormal protection for a whole block of processing, shared by all plugins in this repository.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace darkglass {
+
+// Enables flush-to-zero (and denormals-are-zero on x86) for the lifetime of the object, restoring the previous
+// floating-point mode afterwards. Meant to wrap a whole run(), so the DSP code within needs no per-sample
+// denormal handling, see the "no sanitize" variants of the calf primitives.
+// x86 sets FTZ and DAZ in MXCSR, aarch64 sets FZ in FPCR, 32-bit ARM sets FZ in FPSCR (NEON always flushes).
+// Elsewhere this does nothing. The register is only written when the mode actually changes.
+class scoped_flush_denormals
+{
+#if defined(__SSE__) || defined(__x86_64__) || defined(_M_X64)
+    using fp_mode = unsigned int;
+    static constexpr fp_mode kFlushBits = 0x8040; // FTZ (bit 15) and DAZ (bit 6)
+
+    static fp_mode get() { return _mm_getcsr(); }
+    static void set(fp_mode mode) { _mm_setcsr(mode); }
+#elif defined(__aarch64__)
+    using fp_mode = uint64_t;
+    static constexpr fp_mode kFlushBits = 1u << 24; // FZ
+
+    static fp_mode get() { fp_mode mode; __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode)); return mode; }
+    static void set(fp_mode mode) { __asm__ __volatile__("msr fpcr, %0" : : "r"(mode) : "memory"); }
+#elif defined(__arm__) && defined(__ARM_FP)
+    using fp_mode = uint32_t;
+    static constexpr fp_mode kFlushBits = 1u << 24; // FZ
+
+    static fp_mode get() { fp_mode mode; __asm__ __volatile__("vmrs %0, fpscr" : "=r"(mode)); return mode; }
+    static void set(fp_mode mode) { __asm__ __volatile__("vmsr fpscr, %0" : : "r"(mode) : "memory"); }
+#else
+    using fp_mode = unsigned int;
+    static constexpr fp_mode kFlushBits = 0;
+
+    static fp_mode get() { return 0; }
+    static void set(fp_mode) {}
+#endif
+
+    const fp_mode saved;
+    const fp_mode wanted;
+
+public:
+    // whether this target flushes at all, code that relies on it for denormal handling must keep its own otherwise
+    static constexpr bool effective = kFlushBits != 0;
+
+    // passing false does the opposite and turns flushing off, for measuring the IEEE behaviour
+    explicit scoped_flush_denormals(bool enable = true)
+        : saved(get()),
+          wanted(enable ? saved | kFlushBits : saved & ~kFlushBits)
+    {
+        if (wanted != saved)
+            set(wanted);
+    }
+
+    ~scoped_flush_denormals()
+    {
+        if (wanted != saved)
+            set(saved);
+    }
+
+    scoped_flush_denormals(const scoped_flush_denormals&) = delete;
+    scoped_flush_denormals& operator=(const scoped_flush_denormals&) = delete;
+};
+
+}
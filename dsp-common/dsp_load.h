@@ -0,0 +1,73 @@
+/*
+ * DSP load meter, shared by all plugins in this repository.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace darkglass {
+
+// Measures the time spent in run() against the real-time budget of the block, as a percentage of one core.
+// Reports a smoothed average and a decaying peak, meant for the dsp_load and dsp_peak output ports.
+// A steady clock read costs a few tens of nanoseconds and does not enter the kernel on Linux (vDSO),
+// so this is safe to call from the audio thread.
+class dsp_load_meter
+{
+    using clock = std::chrono::steady_clock;
+
+    // time constants of the average and of the peak decay, in seconds
+    static constexpr double kAverageTime = 0.5;
+    static constexpr double kPeakDecayTime = 2.0;
+
+    double ns_per_frame = 1e9 / 48000;
+    double inv_average_frames = 1.0 / (kAverageTime * 48000);
+    double inv_peak_frames = 1.0 / (kPeakDecayTime * 48000);
+    double average = 0;
+    double peak = 0;
+    clock::time_point start;
+
+public:
+    void set_sample_rate(double sample_rate)
+    {
+        ns_per_frame = 1e9 / sample_rate;
+        inv_average_frames = 1.0 / (kAverageTime * sample_rate);
+        inv_peak_frames = 1.0 / (kPeakDecayTime * sample_rate);
+    }
+
+    void reset()
+    {
+        average = peak = 0;
+    }
+
+    void begin()
+    {
+        start = clock::now();
+    }
+
+    // call after processing nframes, the output ports are optional and may be null
+    void end(uint32_t nframes, float* average_port, float* peak_port)
+    {
+        if (nframes != 0)
+        {
+            const double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            const double load = elapsed / (nframes * ns_per_frame) * 100.0;
+
+            // one pole per block, the coefficient follows the block length so any block size settles alike
+            average += std::min(1.0, nframes * inv_average_frames) * (load - average);
+            peak = std::max(load, peak * (1.0 - std::min(1.0, nframes * inv_peak_frames)));
+        }
+
+        if (average_port != nullptr)
+            *average_port = std::min(average, 100.0);
+        if (peak_port != nullptr)
+            *peak_port = std::min(peak, 100.0);
+    }
+};
+
+}
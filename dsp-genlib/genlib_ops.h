@@ -174,6 +174,20 @@ inline double wrap(double v, double lo1, double hi1){
 	return v - range * double(numWraps);
 }
 
+// float-only wrap into [0, 1), branch-light (truncation plus a select), for |v| < 2^31
+inline float wrap01f(float v) {
+	const float w = v - float(int(v));
+	return (w < 0.f) ? w + 1.f : w;
+}
+
+// float-only version of wrap(), see wrap01f
+inline float wrapf(float v, float lo1, float hi1) {
+	const float lo = (lo1 < hi1) ? lo1 : hi1;
+	const float range = std::fabs(hi1 - lo1);
+	if (range <= 0.000000001f) return lo;
+	return lo + range * wrap01f((v - lo) / range);
+}
+
 // this version gives far better performance when wrapping is relatively rare
 // and typically double of wraps is very low (>1%)
 // but catastrophic if wraps is high (1000%+)
@@ -518,6 +532,23 @@ inline double triangle(double phase, double p1) {
 		return (p1==1.) ? phase : 1. - ((phase - p1) / (1. - p1));
 }
 
+// float-only version of triangle(), written with selects and a single division so it vectorises
+// 1 - (phase - p1) / (1 - p1) is folded into (1 - phase) / (1 - p1), the p1 == 0 and p1 == 1 cases
+// then need no special handling as the matching side of the ramp is never taken
+inline float trianglef(float phase, float p1) {
+	phase = wrap01f(phase);
+	p1 = (p1 < 0.f) ? 0.f : ((p1 > 1.f) ? 1.f : p1);
+	const bool rising = phase < p1;
+	return (rising ? phase : 1.f - phase) / (rising ? p1 : 1.f - p1);
+}
+
+// trianglef() for a p1 held constant over a block, with 1 / p1 and 1 / (1 - p1) computed once by the
+// caller so no division is left per sample, p1 must be within (0, 1)
+inline float trianglef_rcp(float phase, float p1, float rcp_p1, float rcp_1_minus_p1) {
+	phase = wrap01f(phase);
+	return (phase < p1) ? phase * rcp_p1 : (1.f - phase) * rcp_1_minus_p1;
+}
+
 struct Delta {
 	t_sample history;
 	Delta() { reset(); }
@@ -701,6 +732,110 @@ struct Phasor {
 	}
 };
 
+// float-only version of Phasor, with a branchless accumulator valid for increments below one cycle per sample
+struct PhasorF {
+	float phase;
+	PhasorF() { reset(); }
+	void reset(float v=0.f) { phase=v; }
+	inline float operator()(float freq, float invsamplerate) {
+		float v = phase + freq * invsamplerate;
+		v -= (v >= 1.f) ? 1.f : 0.f;
+		v += (v < 0.f) ? 1.f : 0.f;
+		phase = v;
+		return phase;
+	}
+	// advance by n samples at once
+	inline void skip(float freq, float invsamplerate, int n) {
+		phase = wrap01f(phase + freq * invsamplerate * n);
+	}
+};
+
+// integer-phase version of Phasor: a uint32_t accumulator that wraps around by overflow, like SineCycle.
+// The increment is rounded to 2^-32 cycles per sample and then added exactly, so unlike the float
+// accumulators the phase does not drift over time. Output is the top 24 bits, always within [0, 1).
+struct PhasorI {
+	// stands still until freq() is called
+	uint32_t phasei = 0, pincr = 0;
+	PhasorI() { reset(); }
+	void reset(float v=0.f) { phasei = uint32_t(int64_t(double(v) * 4294967296.0)); }
+	inline void freq(float freq, float invsamplerate) {
+		pincr = uint32_t(llrint(double(freq) * double(invsamplerate) * 4294967296.0));
+	}
+	inline float phase() const {
+		return float(int32_t(phasei >> 8)) * float(1.0 / 16777216.0);
+	}
+	inline float operator()() {
+		phasei += pincr;
+		return phase();
+	}
+	// fill out[0..n) with the next n phase values
+	inline void process(float *out, int n) {
+		const uint32_t p0 = phasei;
+		for (int i = 0; i < n; ++i)
+			out[i] = float(int32_t((p0 + pincr * uint32_t(i + 1)) >> 8)) * float(1.0 / 16777216.0);
+		phasei = p0 + pincr * uint32_t(n);
+	}
+	// advance by n samples without output
+	inline void skip(int n) {
+		phasei += pincr * uint32_t(n);
+	}
+};
+
+// one-pole parameter smoother with a sample-rate-independent time constant given in milliseconds,
+// process() fills a whole block in closed form, x[i] = target + coef^(i+1) * (x[-1] - target),
+// and drops to a constant fill once within 1e-6 (relative to 1 + |target|) of the target
+template<int BlockSize>
+struct Smooth {
+	float value, target, coef;
+	bool converged;
+	float decay[BlockSize];
+	Smooth() { setup(10.f, 48000.f); reset(); }
+	void reset(float v=0.f) { value=target=v; converged=true; }
+	void setup(float ms, float samplerate) {
+		coef = float(exp(-1000. / (double(ms) * samplerate)));
+		double d = 1.;
+		for (int i = 0; i < BlockSize; ++i) {
+			d *= coef;
+			decay[i] = float(d);
+		}
+	}
+	inline void set(float v) {
+		if (v != target) {
+			target = v;
+			converged = false;
+		}
+	}
+	// fill out[0..n) with the next n smoothed values, n <= BlockSize
+	inline void process(float *out, int n) {
+		if (n <= 0)
+			return;
+		if (converged) {
+			for (int i = 0; i < n; ++i)
+				out[i] = target;
+			return;
+		}
+		const float t = target;
+		const float diff = value - t;
+		for (int i = 0; i < n; ++i)
+			out[i] = t + decay[i] * diff;
+		value = out[n - 1];
+		check_converged();
+	}
+	// advance by n samples without output
+	inline void skip(int n) {
+		if (converged)
+			return;
+		value = target + float(pow(double(coef), n)) * (value - target);
+		check_converged();
+	}
+	inline void check_converged() {
+		if (fabsf(value - target) <= 1e-6f * (1.f + fabsf(target))) {
+			value = target;
+			converged = true;
+		}
+	}
+};
+
 struct PlusEquals {
 	t_sample count;
 	PlusEquals() { reset(); }
@@ -0,0 +1,353 @@
+/*
+ * Offline benchmark for the plugin bundles in this repository.
+ *
+ * Every plugin of every bundle given on the command line is instantiated and driven with a synthetic
+ * signal, for each combination of sample rate, block size and parameter preset.
+ * Results are written as CSV, one row per combination.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#include "lv2host.h"
+
+#include <getopt.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Preset {
+    std::string name;
+    std::string settings;
+};
+
+struct Options {
+    std::vector<uint32_t> block_sizes = { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+    std::vector<double> sample_rates = { 48000 };
+    std::vector<Preset> presets;
+    std::string uri_filter;
+    std::string signal = "sine";
+    double seconds = 4;
+    int repeat = 5;
+    bool in_place = false;
+    FILE* output = stdout;
+};
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options] bundle...\n"
+                 "  -b, --block-sizes LIST    block sizes to test, default 16,32,64,128,256,512,1024,2048\n"
+                 "  -r, --rates LIST          sample rates to test, default 48000\n"
+                 "  -p, --preset NAME:SET     parameter preset, SET is symbol=value,... (repeatable)\n"
+                 "                            without presets the ttl defaults are used, as preset 'default'\n"
+                 "  -u, --uri TEXT            only plugins whose URI contains TEXT\n"
+                 "  -g, --signal TYPE         sine, noise, decay or silence, default sine\n"
+                 "  -s, --seconds N           seconds of audio per timed pass, default 4\n"
+                 "  -n, --repeat N            timed passes, the fastest one is reported, default 5\n"
+                 "  -i, --in-place            connect outputs to the same buffers as inputs\n"
+                 "  -o, --output FILE         write CSV to FILE instead of stdout\n",
+                 argv0);
+}
+
+static inline double now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// one second of signal per channel, plus room for a full block past the end so blocks never wrap
+// decay is 10 ms of noise followed by silence, so that the plugin state decays through the denormal range
+static std::vector<std::vector<float>> make_signal(const std::string& type, uint32_t channels, double sample_rate,
+                                                   uint32_t block_size)
+{
+    const uint32_t length = sample_rate;
+    std::vector<std::vector<float>> signal(channels, std::vector<float>(length + block_size, 0.f));
+    uint32_t seed = 0x9e3779b9;
+
+    for (uint32_t c = 0; c < channels; ++c)
+    {
+        std::vector<float>& buffer = signal[c];
+
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            if (type == "sine")
+            {
+                // a low E with a couple of harmonics, slightly detuned per channel
+                const double w = 2.0 * M_PI * 82.41 * (1.0 + 0.001 * c) * i / sample_rate;
+                buffer[i] = 0.5f * std::sin(w) + 0.2f * std::sin(2 * w) + 0.1f * std::sin(3 * w);
+            }
+            else if (type == "noise" || (type == "decay" && i < sample_rate / 100))
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                buffer[i] = seed * (1.0f / 4294967296.0f) - 0.5f;
+            }
+        }
+
+        std::copy_n(buffer.begin(), block_size, buffer.begin() + length);
+    }
+
+    return signal;
+}
+
+static bool preset_applies(const lv2host::PluginInfo& info, const Preset& preset)
+{
+    if (preset.settings.empty())
+        return true;
+
+    for (const std::string& item : lv2host::split(preset.settings))
+    {
+        const lv2host::Port* const port = info.find(item.substr(0, item.find('=')));
+        if (port == nullptr || port->audio)
+            return false;
+    }
+
+    return true;
+}
+
+struct Result {
+    double ns_per_sample;
+    double mean_block_us;
+    double worst_block_us;
+};
+
+static bool measure(const Options& opts, const LV2_Descriptor* desc, const lv2host::PluginInfo& info,
+                    const Preset& preset, double sample_rate, uint32_t block_size, Result& result)
+{
+    lv2host::Instance instance(desc, info, sample_rate, block_size);
+
+    if (instance.handle == nullptr)
+    {
+        std::fprintf(stderr, "%s: failed to instantiate\n", info.uri.c_str());
+        return false;
+    }
+    if (! lv2host::apply_controls(instance, preset.settings))
+        return false;
+
+    const uint32_t channels = instance.audio_ins.size();
+    const std::vector<std::vector<float>> signal = make_signal(opts.signal, channels, sample_rate, block_size);
+    const uint32_t length = sample_rate;
+
+    std::vector<const float*> ins(channels);
+    std::vector<float*> outs(instance.audio_outs.size());
+    for (size_t c = 0; c < outs.size(); ++c)
+        outs[c] = instance.audio_outs[c].data();
+
+    uint32_t offset = 0;
+    const auto run_block = [&]() {
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            if (opts.in_place && c < outs.size())
+            {
+                std::memcpy(outs[c], signal[c].data() + offset, sizeof(float) * block_size);
+                ins[c] = outs[c];
+            }
+            else
+            {
+                ins[c] = signal[c].data() + offset;
+            }
+        }
+        instance.connect_audio(ins.data(), outs.data());
+        instance.run(block_size);
+        offset = (offset + block_size) % length;
+    };
+
+    const uint64_t blocks = std::max<uint64_t>(1, opts.seconds * sample_rate / block_size);
+
+    instance.activate();
+
+    // warm up caches, branch predictors and any smoothing in the plugin
+    for (uint64_t i = 0, n = std::max<uint64_t>(1, 0.25 * sample_rate / block_size); i < n; ++i)
+        run_block();
+
+    // mean cost: whole passes, the fastest one is the least disturbed by the rest of the system
+    double best_pass = 1e300;
+    for (int r = 0; r < opts.repeat; ++r)
+    {
+        const double start = now_ns();
+        for (uint64_t i = 0; i < blocks; ++i)
+            run_block();
+        best_pass = std::min(best_pass, now_ns() - start);
+    }
+
+    // worst case: one more pass with every block timed on its own
+    double worst_block = 0;
+    for (uint64_t i = 0; i < blocks; ++i)
+    {
+        const double start = now_ns();
+        run_block();
+        worst_block = std::max(worst_block, now_ns() - start);
+    }
+
+    instance.deactivate();
+
+    result.ns_per_sample = best_pass / (blocks * block_size);
+    result.mean_block_us = best_pass / blocks * 1e-3;
+    result.worst_block_us = worst_block * 1e-3;
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    static const option long_options[] = {
+        { "block-sizes", required_argument, nullptr, 'b' },
+        { "rates", required_argument, nullptr, 'r' },
+        { "preset", required_argument, nullptr, 'p' },
+        { "uri", required_argument, nullptr, 'u' },
+        { "signal", required_argument, nullptr, 'g' },
+        { "seconds", required_argument, nullptr, 's' },
+        { "repeat", required_argument, nullptr, 'n' },
+        { "in-place", no_argument, nullptr, 'i' },
+        { "output", required_argument, nullptr, 'o' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    for (int c; (c = getopt_long(argc, argv, "b:r:p:u:g:s:n:io:h", long_options, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'b':
+            opts.block_sizes.clear();
+            for (const std::string& item : lv2host::split(optarg))
+                opts.block_sizes.push_back(std::strtoul(item.c_str(), nullptr, 10));
+            break;
+        case 'r':
+            opts.sample_rates.clear();
+            for (const std::string& item : lv2host::split(optarg))
+                opts.sample_rates.push_back(std::strtod(item.c_str(), nullptr));
+            break;
+        case 'p':
+            if (const char* const colon = std::strchr(optarg, ':'))
+                opts.presets.push_back({ std::string(optarg, colon - optarg), colon + 1 });
+            else
+                opts.presets.push_back({ optarg, optarg });
+            break;
+        case 'u':
+            opts.uri_filter = optarg;
+            break;
+        case 'g':
+            opts.signal = optarg;
+            break;
+        case 's':
+            opts.seconds = std::strtod(optarg, nullptr);
+            break;
+        case 'n':
+            opts.repeat = std::max(1, std::atoi(optarg));
+            break;
+        case 'i':
+            opts.in_place = true;
+            break;
+        case 'o':
+            opts.output = std::fopen(optarg, "w");
+            if (opts.output == nullptr)
+            {
+                std::fprintf(stderr, "failed to open %s for writing\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind == argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opts.signal != "sine" && opts.signal != "noise" && opts.signal != "decay" && opts.signal != "silence")
+    {
+        std::fprintf(stderr, "unknown signal type '%s'\n", opts.signal.c_str());
+        return 1;
+    }
+    for (uint32_t block_size : opts.block_sizes)
+    {
+        if (block_size == 0)
+        {
+            std::fprintf(stderr, "invalid block size\n");
+            return 1;
+        }
+    }
+    if (opts.presets.empty())
+        opts.presets.push_back({ "default", "" });
+
+    std::fprintf(opts.output, "uri,sample_rate,block_size,preset,signal,in_place,"
+                              "ns_per_sample,mean_block_us,worst_block_us,cpu_load_pct,worst_load_pct\n");
+
+    int failures = 0;
+
+    for (int i = optind; i < argc; ++i)
+    {
+        const std::string bundle = argv[i];
+        const lv2host::Library library(bundle);
+        const std::vector<lv2host::PluginInfo> plugins = lv2host::parse_bundle(bundle);
+
+        if (library.descriptor_function == nullptr || plugins.empty())
+        {
+            std::fprintf(stderr, "%s: not a usable bundle\n", bundle.c_str());
+            ++failures;
+            continue;
+        }
+
+        for (const lv2host::PluginInfo& info : plugins)
+        {
+            if (info.uri.find(opts.uri_filter) == std::string::npos)
+                continue;
+
+            const LV2_Descriptor* const desc = library.find(info.uri);
+            if (desc == nullptr)
+            {
+                std::fprintf(stderr, "%s: described in ttl but not in the binary\n", info.uri.c_str());
+                ++failures;
+                continue;
+            }
+
+            for (const Preset& preset : opts.presets)
+            {
+                // presets are usually written for one plugin family, skip the others
+                if (! preset_applies(info, preset))
+                    continue;
+
+                for (double sample_rate : opts.sample_rates)
+                {
+                    for (uint32_t block_size : opts.block_sizes)
+                    {
+                        Result result;
+                        if (! measure(opts, desc, info, preset, sample_rate, block_size, result))
+                        {
+                            ++failures;
+                            continue;
+                        }
+
+                        const double block_period_us = block_size / sample_rate * 1e6;
+
+                        std::fprintf(opts.output, "%s,%g,%u,%s,%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                                     info.uri.c_str(), sample_rate, block_size, preset.name.c_str(),
+                                     opts.signal.c_str(), opts.in_place ? 1 : 0,
+                                     result.ns_per_sample, result.mean_block_us, result.worst_block_us,
+                                     result.mean_block_us / block_period_us * 100,
+                                     result.worst_block_us / block_period_us * 100);
+                        std::fflush(opts.output);
+                    }
+                }
+            }
+        }
+    }
+
+    if (opts.output != stdout)
+        std::fclose(opts.output);
+
+    return failures == 0 ? 0 : 1;
+}
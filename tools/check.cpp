@@ -0,0 +1,550 @@
+/*
+ * Golden-output regression check for the plugin bundles in this repository.
+ *
+ * Every test renders a fixed stimulus through the mono, stereo and multiband variants of a plugin, with a set of
+ * parameter values and optional automation, and compares the result against a reference render kept
+ * in tools/golden, using per-test tolerances for max abs error, SNR and log-spectral distance.
+ * Each render is also repeated in-place at a few block sizes, which must match the out-of-place render exactly.
+ *
+ * Run with --update to (re)generate the references after an intended change in output.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#include "lv2host.h"
+
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static constexpr double kSampleRate = 48000;
+static constexpr uint32_t kBlockSize = 64;
+// in-place renders are also compared at these, odd sizes and ones across the 128-frame chunks of the bypass crossfade
+static constexpr uint32_t kInPlaceBlockSizes[] = { 17, kBlockSize, 256 };
+// 0.2 seconds, references are stored in the repository so keep them short
+static constexpr uint32_t kFrames = 9600;
+
+struct Event {
+    uint32_t frame;
+    const char* symbol;
+    float value;
+};
+
+struct Tolerance {
+    double max_abs;
+    double min_snr_db;
+    double max_lsd_db;
+};
+
+struct Test {
+    const char* bundle;
+    const char* name;
+    // "symbol=value,..." applied before activation
+    const char* controls;
+    // control changes while running, applied at the start of the block containing the frame
+    std::vector<Event> events;
+    Tolerance tolerance;
+};
+
+static constexpr Tolerance kDefaultTolerance = { 1e-3, 60.0, 0.5 };
+// high feedback amplifies any difference in the cascade
+static constexpr Tolerance kFeedbackTolerance = { 5e-3, 45.0, 1.0 };
+
+static const std::vector<Test> kTests = {
+    { "dark-phaser", "default", "rate=2", {}, kDefaultTolerance },
+    { "dark-phaser", "deep", "Color=400,depth=10800,rate=5,feedback=9.5,stages=12", {}, kFeedbackTolerance },
+    { "dark-phaser", "light", "Color=5000,depth=1000,rate=0.5,feedback=0,stages=1", {}, kDefaultTolerance },
+    { "dark-phaser", "automation", "rate=2", {
+        { kFrames / 2, "stages", 8 },
+        { kFrames / 2, "feedback", 2 },
+        { kFrames / 2, "rate", 8 },
+        { kFrames * 3 / 4, "stages", 2 },
+    }, kDefaultTolerance },
+    { "dark-phaser", "bypass", "rate=2", {
+        { kFrames / 3, "enabled", 0 },
+        { kFrames * 2 / 3, "enabled", 1 },
+    }, kDefaultTolerance },
+
+    { "dark-tremolo", "default", "", {}, kDefaultTolerance },
+    { "dark-tremolo", "hard", "rate=12,shape=0,depth=100", {}, kDefaultTolerance },
+    { "dark-tremolo", "soft", "rate=1,shape=10,depth=40,stphase=90", {}, kDefaultTolerance },
+    { "dark-tremolo", "automation", "", {
+        { kFrames / 2, "shape", 9 },
+        { kFrames / 2, "depth", 20 },
+        { kFrames / 2, "rate", 15 },
+    }, kDefaultTolerance },
+    { "dark-tremolo", "bypass", "", {
+        { kFrames / 3, "enabled", 0 },
+        { kFrames * 2 / 3, "enabled", 1 },
+    }, kDefaultTolerance },
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// stimulus: plucked notes with decaying harmonics, a burst of noise, silence and an impulse
+
+static std::vector<std::vector<float>> make_stimulus(uint32_t channels)
+{
+    std::vector<std::vector<float>> stimulus(channels, std::vector<float>(kFrames, 0.f));
+    uint32_t seed = 0x2545f491;
+
+    for (uint32_t c = 0; c < channels; ++c)
+    {
+        std::vector<float>& buffer = stimulus[c];
+        const double notes[] = { 82.41, 110.0, 146.83, 98.0 };
+        const uint32_t note_length = kFrames / 8;
+
+        for (uint32_t i = 0; i < kFrames; ++i)
+        {
+            const uint32_t section = i / note_length;
+            const uint32_t t = i % note_length;
+
+            if (section < 4)
+            {
+                const double f = notes[(section + c) % 4];
+                const double env = std::exp(-8.0 * t / note_length);
+                double v = 0;
+                for (int h = 1; h <= 6; ++h)
+                    v += std::sin(2.0 * M_PI * f * h * t / kSampleRate) / h;
+                buffer[i] = 0.5 * env * v;
+            }
+            else if (section < 6)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                buffer[i] = (seed * (1.0f / 4294967296.0f) - 0.5f) * 0.5f;
+            }
+            else if (section == 7 && t == note_length / 2)
+            {
+                buffer[i] = 0.9f;
+            }
+        }
+    }
+
+    return stimulus;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// wav files, 32-bit float interleaved, little-endian hosts only
+
+static bool write_wav(const std::string& path, const std::vector<float>& interleaved, uint32_t channels)
+{
+    FILE* const f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+
+    const uint32_t data_size = interleaved.size() * sizeof(float);
+    const uint32_t riff_size = 4 + (8 + 16) + (8 + data_size);
+    const uint16_t format = 3, bits = 32, block_align = channels * sizeof(float);
+    const uint16_t channels16 = channels;
+    const uint32_t rate = kSampleRate, byte_rate = rate * block_align, fmt_size = 16;
+
+    std::fwrite("RIFF", 1, 4, f);
+    std::fwrite(&riff_size, 4, 1, f);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    std::fwrite(&fmt_size, 4, 1, f);
+    std::fwrite(&format, 2, 1, f);
+    std::fwrite(&channels16, 2, 1, f);
+    std::fwrite(&rate, 4, 1, f);
+    std::fwrite(&byte_rate, 4, 1, f);
+    std::fwrite(&block_align, 2, 1, f);
+    std::fwrite(&bits, 2, 1, f);
+    std::fwrite("data", 1, 4, f);
+    std::fwrite(&data_size, 4, 1, f);
+    std::fwrite(interleaved.data(), sizeof(float), interleaved.size(), f);
+
+    return std::fclose(f) == 0;
+}
+
+static bool read_wav(const std::string& path, std::vector<float>& interleaved, uint32_t& channels)
+{
+    const std::string data = lv2host::read_file(path);
+
+    if (data.size() < 12 || data.compare(0, 4, "RIFF") != 0 || data.compare(8, 4, "WAVE") != 0)
+        return false;
+
+    bool has_format = false;
+    for (size_t pos = 12; pos + 8 <= data.size();)
+    {
+        uint32_t size;
+        std::memcpy(&size, data.data() + pos + 4, 4);
+
+        if (data.compare(pos, 4, "fmt ") == 0 && size >= 16)
+        {
+            uint16_t format, channels16, bits;
+            std::memcpy(&format, data.data() + pos + 8, 2);
+            std::memcpy(&channels16, data.data() + pos + 10, 2);
+            std::memcpy(&bits, data.data() + pos + 22, 2);
+            if (format != 3 || bits != 32)
+                return false;
+            channels = channels16;
+            has_format = true;
+        }
+        else if (data.compare(pos, 4, "data") == 0 && has_format)
+        {
+            interleaved.resize(std::min<size_t>(size, data.size() - pos - 8) / sizeof(float));
+            std::memcpy(interleaved.data(), data.data() + pos + 8, interleaved.size() * sizeof(float));
+            return true;
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    return false;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// rendering
+
+// renders the stimulus in kBlockSize blocks, returns interleaved output or nothing on failure
+static std::vector<float> render(const LV2_Descriptor* desc, const lv2host::PluginInfo& info, const Test& test,
+                                 bool in_place, uint32_t block_size = kBlockSize)
+{
+    lv2host::Instance instance(desc, info, kSampleRate, block_size);
+
+    if (instance.handle == nullptr || ! lv2host::apply_controls(instance, test.controls))
+        return {};
+
+    const uint32_t channels = instance.audio_outs.size();
+    const std::vector<std::vector<float>> stimulus = make_stimulus(instance.audio_ins.size());
+    std::vector<std::vector<float>> outputs(channels, std::vector<float>(kFrames, 0.f));
+
+    if (in_place)
+        for (uint32_t c = 0; c < channels && c < stimulus.size(); ++c)
+            outputs[c] = stimulus[c];
+
+    std::vector<const float*> ins(stimulus.size());
+    std::vector<float*> outs(channels);
+
+    instance.activate();
+
+    for (uint32_t pos = 0; pos < kFrames; pos += block_size)
+    {
+        const uint32_t frames = std::min(block_size, kFrames - pos);
+
+        for (const Event& event : test.events)
+        {
+            if (event.frame >= pos && event.frame < pos + frames)
+                instance.set_control(event.symbol, event.value);
+        }
+
+        for (size_t c = 0; c < ins.size(); ++c)
+            ins[c] = in_place && c < channels ? outputs[c].data() + pos : stimulus[c].data() + pos;
+        for (uint32_t c = 0; c < channels; ++c)
+            outs[c] = outputs[c].data() + pos;
+
+        instance.connect_audio(ins.data(), outs.data());
+        instance.run(frames);
+    }
+
+    instance.deactivate();
+
+    std::vector<float> interleaved(kFrames * channels);
+    for (uint32_t i = 0; i < kFrames; ++i)
+        for (uint32_t c = 0; c < channels; ++c)
+            interleaved[i * channels + c] = outputs[c][i];
+
+    return interleaved;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// metrics
+
+static void fft(std::vector<std::complex<double>>& x)
+{
+    const size_t n = x.size();
+
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(x[i], x[j]);
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        const std::complex<double> wlen = std::polar(1.0, -2.0 * M_PI / len);
+        for (size_t i = 0; i < n; i += len)
+        {
+            std::complex<double> w = 1.0;
+            for (size_t k = 0; k < len / 2; ++k)
+            {
+                const std::complex<double> u = x[i + k];
+                const std::complex<double> v = x[i + k + len / 2] * w;
+                x[i + k] = u + v;
+                x[i + k + len / 2] = u - v;
+                w *= wlen;
+            }
+        }
+    }
+}
+
+struct Metrics {
+    double max_abs = 0;
+    double snr_db = INFINITY;
+    double lsd_db = 0;
+};
+
+// log-spectral distance in dB, averaged over 1024-point hann frames with 50% overlap,
+// bins under -120 dBFS in both signals count as equal
+static double log_spectral_distance(const std::vector<float>& ref, const std::vector<float>& test,
+                                    uint32_t channels, uint32_t channel)
+{
+    constexpr size_t kFftSize = 1024;
+    constexpr double kFloor = 1e-6;
+
+    const size_t frames = ref.size() / channels;
+    double total = 0;
+    int count = 0;
+
+    for (size_t start = 0; start + kFftSize <= frames; start += kFftSize / 2)
+    {
+        std::vector<std::complex<double>> a(kFftSize), b(kFftSize);
+
+        for (size_t i = 0; i < kFftSize; ++i)
+        {
+            const double window = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / kFftSize);
+            a[i] = ref[(start + i) * channels + channel] * window;
+            b[i] = test[(start + i) * channels + channel] * window;
+        }
+
+        fft(a);
+        fft(b);
+
+        double sum = 0;
+        for (size_t k = 0; k <= kFftSize / 2; ++k)
+        {
+            const double scale = 2.0 / kFftSize;
+            const double da = 20 * std::log10(std::max(std::abs(a[k]) * scale, kFloor));
+            const double db = 20 * std::log10(std::max(std::abs(b[k]) * scale, kFloor));
+            sum += (da - db) * (da - db);
+        }
+
+        total += std::sqrt(sum / (kFftSize / 2 + 1));
+        ++count;
+    }
+
+    return count != 0 ? total / count : 0;
+}
+
+static Metrics compare(const std::vector<float>& ref, const std::vector<float>& test, uint32_t channels)
+{
+    Metrics m;
+    double signal = 0, noise = 0;
+
+    for (size_t i = 0; i < ref.size(); ++i)
+    {
+        const double error = double(test[i]) - double(ref[i]);
+        m.max_abs = std::max(m.max_abs, std::abs(error));
+        signal += double(ref[i]) * ref[i];
+        noise += error * error;
+    }
+
+    if (noise > 0)
+        m.snr_db = signal > 0 ? 10 * std::log10(signal / noise) : -INFINITY;
+
+    for (uint32_t c = 0; c < channels; ++c)
+        m.lsd_db = std::max(m.lsd_db, log_spectral_distance(ref, test, channels, c));
+
+    return m;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options] bundle...\n"
+                 "  -r, --refs DIR        reference directory, default tools/golden\n"
+                 "  -u, --filter TEXT     only tests whose name (uri:test) contains TEXT\n"
+                 "  -w, --update          write new references instead of comparing\n"
+                 "  -v, --verbose         print metrics for passing tests too\n",
+                 argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string refs = "tools/golden";
+    std::string filter;
+    bool update = false;
+    bool verbose = false;
+
+    static const option long_options[] = {
+        { "refs", required_argument, nullptr, 'r' },
+        { "filter", required_argument, nullptr, 'u' },
+        { "update", no_argument, nullptr, 'w' },
+        { "verbose", no_argument, nullptr, 'v' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    for (int c; (c = getopt_long(argc, argv, "r:u:wvh", long_options, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'r':
+            refs = optarg;
+            break;
+        case 'u':
+            filter = optarg;
+            break;
+        case 'w':
+            update = true;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind == argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int passed = 0, failed = 0;
+
+    for (int i = optind; i < argc; ++i)
+    {
+        std::string bundle = argv[i];
+        while (! bundle.empty() && bundle.back() == '/')
+            bundle.pop_back();
+
+        // "path/to/dark-phaser.lv2" -> "dark-phaser"
+        std::string name = bundle.substr(bundle.find_last_of('/') + 1);
+        name = name.substr(0, name.rfind(".lv2"));
+
+        const lv2host::Library library(bundle);
+        const std::vector<lv2host::PluginInfo> plugins = lv2host::parse_bundle(bundle);
+
+        if (library.descriptor_function == nullptr || plugins.empty())
+        {
+            std::printf("FAIL %s: not a usable bundle\n", bundle.c_str());
+            ++failed;
+            continue;
+        }
+
+        for (const lv2host::PluginInfo& info : plugins)
+        {
+            // mono, stereo and variants with their own processing, references for the others would be mostly redundant
+            const size_t hash = info.uri.find('#');
+            const std::string variant = hash == std::string::npos ? "mono" : info.uri.substr(hash + 1);
+            if (variant != "mono" && variant != "stereo" && variant != "multiband")
+                continue;
+
+            const LV2_Descriptor* const desc = library.find(info.uri);
+
+            for (const Test& test : kTests)
+            {
+                if (name != test.bundle)
+                    continue;
+
+                const std::string label = info.uri + ":" + test.name;
+                if (label.find(filter) == std::string::npos)
+                    continue;
+
+                if (desc == nullptr)
+                {
+                    std::printf("FAIL %s: described in ttl but not in the binary\n", label.c_str());
+                    ++failed;
+                    continue;
+                }
+
+                const std::vector<float> output = render(desc, info, test, false);
+                const uint32_t channels = info.count(true, false);
+
+                if (output.empty())
+                {
+                    std::printf("FAIL %s: could not render\n", label.c_str());
+                    ++failed;
+                    continue;
+                }
+
+                // automation lands at block starts, so each block size needs its own out-of-place reference
+                uint32_t in_place_failure = 0;
+                for (const uint32_t block_size : kInPlaceBlockSizes)
+                {
+                    const std::vector<float> reference = block_size == kBlockSize
+                                                       ? output : render(desc, info, test, false, block_size);
+                    const std::vector<float> in_place = render(desc, info, test, true, block_size);
+                    if (in_place.size() != reference.size() ||
+                        std::memcmp(reference.data(), in_place.data(), reference.size() * sizeof(float)) != 0)
+                    {
+                        in_place_failure = block_size;
+                        break;
+                    }
+                }
+                if (in_place_failure != 0)
+                {
+                    std::printf("FAIL %s: in-place output differs from out-of-place at block size %u\n",
+                                label.c_str(), in_place_failure);
+                    ++failed;
+                    continue;
+                }
+
+                const std::string path = refs + "/" + name + "/" + variant + "-" + test.name + ".wav";
+
+                if (update)
+                {
+                    mkdir(refs.c_str(), 0755);
+                    mkdir((refs + "/" + name).c_str(), 0755);
+
+                    if (! write_wav(path, output, channels))
+                    {
+                        std::printf("FAIL %s: could not write %s\n", label.c_str(), path.c_str());
+                        ++failed;
+                        continue;
+                    }
+                    std::printf("WROTE %s\n", path.c_str());
+                    ++passed;
+                    continue;
+                }
+
+                std::vector<float> reference;
+                uint32_t ref_channels = 0;
+                if (! read_wav(path, reference, ref_channels))
+                {
+                    std::printf("FAIL %s: no reference at %s, run with --update to create it\n",
+                                label.c_str(), path.c_str());
+                    ++failed;
+                    continue;
+                }
+                if (ref_channels != channels || reference.size() != output.size())
+                {
+                    std::printf("FAIL %s: reference has a different layout\n", label.c_str());
+                    ++failed;
+                    continue;
+                }
+
+                const Metrics m = compare(reference, output, channels);
+                const Tolerance& t = test.tolerance;
+                const bool ok = m.max_abs <= t.max_abs && m.snr_db >= t.min_snr_db && m.lsd_db <= t.max_lsd_db;
+
+                if (! ok || verbose)
+                {
+                    std::printf("%s %s: max abs %.3g (<= %.3g), snr %.1f dB (>= %.1f), lsd %.3f dB (<= %.3f)\n",
+                                ok ? "PASS" : "FAIL", label.c_str(),
+                                m.max_abs, t.max_abs, m.snr_db, t.min_snr_db, m.lsd_db, t.max_lsd_db);
+                }
+
+                ++(ok ? passed : failed);
+            }
+        }
+    }
+
+    std::printf("%d passed, %d failed\n", passed, failed);
+    return failed == 0 && passed != 0 ? 0 : 1;
+}
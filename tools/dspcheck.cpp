@@ -0,0 +1,602 @@
+/*
+ * Compatibility check for the block engines of the DSP primitives in dsp-calf.
+ *
+ * A primitive with both a per-frame and a block API is fed the same stimulus through each, and the block output is
+ * compared against the frame output, with tolerances for max abs error and SNR.
+ * The block output must also be the same whatever the block size, in-place or not.
+ * Replacements of the genlib primitives are checked to be no less accurate than what they replace.
+ * Built with the same flags as the plugins, like microbench.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// calf first, genlib defines a few macros that are best kept out of the standard headers
+#include "audio_fx.cpp"
+
+#include "genlib.cpp"
+#include "genlib_ops.h"
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static constexpr uint32_t kSampleRate = 48000;
+
+// --------------------------------------------------------------------------------------------------------------------
+// lookahead_limiter, block engine against frame engine
+
+// 1 second, the first 110 ms are silent so that the frame limiter is done zeroing its buffer for any attack time
+static constexpr uint32_t kFrames = 48000;
+static constexpr uint32_t kLeadIn = 5280;
+// the reference block size, and the others that must give exactly the same output
+static constexpr uint32_t kBlockSize = 128;
+static constexpr uint32_t kOtherBlockSizes[] = { 1, 37, 4096 };
+
+enum Stimulus {
+    kBursts,  // isolated 1 kHz bursts of 2 ms at several levels, far apart
+    kPlucks,  // decaying saw notes retriggered every 150 ms
+    kNoise,   // white noise under a slow swell
+};
+
+struct Tolerance {
+    double max_abs;
+    double min_snr_db;
+};
+
+struct Test {
+    const char* name;
+    Stimulus stimulus;
+    float attack_ms;
+    float release_ms;
+    bool auto_release;
+};
+
+// The block engine follows the frame engine sample by sample, attack, release and asc alike. All that is left is its
+// brickwall, the frame engine ramps its gain in float and can overshoot the limit by its rounding, 1e-5 or so and up to
+// 1e-4 over the longest ramps, where the block engine clamps the gain.
+static const Test kTests[] = {
+    { "bursts",          kBursts, 5.f,   50.f,  false },
+    { "bursts-asc",      kBursts, 5.f,   50.f,  true  },
+    { "bursts-long",     kBursts, 50.f,  200.f, false },
+    { "plucks",          kPlucks, 5.f,   50.f,  false },
+    { "plucks-asc",      kPlucks, 5.f,   50.f,  true  },
+    { "plucks-short",    kPlucks, 1.f,   20.f,  false },
+    { "noise",           kNoise,  5.f,   50.f,  false },
+    { "noise-asc",       kNoise,  5.f,   50.f,  true  },
+    { "noise-long",      kNoise,  100.f, 500.f, false },
+};
+
+static constexpr Tolerance kLimiterTolerance = { 1e-4, 95.0 };
+static constexpr float kLimit = 0.5f;
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static void generate(Stimulus stimulus, std::vector<float>& left, std::vector<float>& right)
+{
+    left.assign(kFrames, 0.f);
+    right.assign(kFrames, 0.f);
+
+    uint32_t seed = 0x2545f491;
+    const auto noise = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed * (1.0f / 4294967296.0f) - 0.5f;
+    };
+
+    for (uint32_t i = kLeadIn; i < kFrames; ++i)
+    {
+        const uint32_t t = i - kLeadIn;
+        float l = 0.f, r = 0.f;
+
+        switch (stimulus)
+        {
+        case kBursts: {
+            // one burst every 200 ms, louder each time, the right channel 6 dB below
+            const uint32_t k = t / 9600, u = t % 9600;
+            if (u < 96)
+                l = (0.75f + 0.5f * k) * std::sin(2.f * M_PI * 1000.f * u / kSampleRate);
+            r = 0.5f * l;
+            break;
+        }
+        case kPlucks: {
+            const uint32_t k = t / 7200, u = t % 7200;
+            const float freq = 82.41f * (1 + k % 3);
+            const float phase = std::fmod(freq * u / kSampleRate, 1.f);
+            const float env = (0.6f + 0.3f * (k % 4)) * std::exp(-(float)u / 2400.f);
+            l = env * (2.f * phase - 1.f);
+            r = env * std::sin(2.f * M_PI * phase);
+            break;
+        }
+        case kNoise: {
+            const float env = 0.25f + 1.75f * std::sin(M_PI * t / (kFrames - kLeadIn));
+            l = env * noise();
+            r = env * noise();
+            break;
+        }
+        }
+
+        left[i] = l;
+        right[i] = r;
+    }
+}
+
+static void setup(dsp::lookahead_limiter& limiter, const Test& test)
+{
+    limiter.set_sample_rate(kSampleRate);
+    limiter.set_params(kLimit, test.attack_ms, test.release_ms, 1.f, test.auto_release);
+    limiter.reset();
+}
+
+static void render_frames(const Test& test, std::vector<float>& left, std::vector<float>& right)
+{
+    dsp::lookahead_limiter limiter;
+    setup(limiter, test);
+
+    for (uint32_t i = 0; i < kFrames; ++i)
+        limiter.process(left[i], right[i], nullptr);
+}
+
+static void render_blocks(const Test& test, uint32_t block_size, bool in_place,
+                          const std::vector<float>& in_l, const std::vector<float>& in_r,
+                          std::vector<float>& out_l, std::vector<float>& out_r)
+{
+    dsp::lookahead_limiter limiter;
+    setup(limiter, test);
+
+    out_l = in_l;
+    out_r = in_r;
+
+    for (uint32_t i = 0; i < kFrames; i += block_size)
+    {
+        const uint32_t n = std::min(block_size, kFrames - i);
+        const float* const ins[2] = { (in_place ? out_l : in_l).data() + i, (in_place ? out_r : in_r).data() + i };
+        float* const outs[2] = { out_l.data() + i, out_r.data() + i };
+        limiter.process(ins, outs, n);
+    }
+}
+
+static void check_limiter(const std::string& filter, bool verbose, int& passed, int& failed)
+{
+    for (const Test& test : kTests)
+    {
+        const std::string label = std::string("lookahead_limiter:") + test.name;
+        if (label.find(filter) == std::string::npos)
+            continue;
+
+        std::vector<float> in_l, in_r;
+        generate(test.stimulus, in_l, in_r);
+
+        std::vector<float> ref_l = in_l, ref_r = in_r;
+        render_frames(test, ref_l, ref_r);
+
+        std::vector<float> out_l, out_r;
+        render_blocks(test, kBlockSize, false, in_l, in_r, out_l, out_r);
+
+        bool same = true;
+        for (const uint32_t block_size : kOtherBlockSizes)
+        {
+            for (const bool in_place : { false, true })
+            {
+                std::vector<float> l, r;
+                render_blocks(test, block_size, in_place, in_l, in_r, l, r);
+                same = same && l == out_l && r == out_r;
+            }
+        }
+        if (! same)
+        {
+            std::printf("FAIL %s: output depends on the block size or on running in-place\n", label.c_str());
+            ++failed;
+            continue;
+        }
+
+        double max_abs = 0.0, max_out = 0.0, signal = 0.0, error = 0.0;
+        for (uint32_t i = 0; i < kFrames; ++i)
+        {
+            for (const auto& [ref, out] : { std::make_pair(ref_l[i], out_l[i]), std::make_pair(ref_r[i], out_r[i]) })
+            {
+                max_abs = std::max(max_abs, (double)std::fabs(ref - out));
+                max_out = std::max(max_out, (double)std::fabs(out));
+                signal += (double)ref * ref;
+                error += (double)(ref - out) * (ref - out);
+            }
+        }
+        const double snr_db = 10.0 * std::log10(signal / std::max(error, 1e-30));
+
+        // the block engine is a brickwall, allowing for float rounding only
+        const Tolerance& t = kLimiterTolerance;
+        const bool ok = max_out <= kLimit * (1.0 + 1e-6) && max_abs <= t.max_abs && snr_db >= t.min_snr_db;
+
+        if (! ok || verbose)
+        {
+            std::printf("%s %s: peak %.6g (<= %.6g), max abs %.3g (<= %.3g), snr %.1f dB (>= %.1f)\n",
+                        ok ? "PASS" : "FAIL", label.c_str(),
+                        max_out, kLimit, max_abs, t.max_abs, snr_db, t.min_snr_db);
+        }
+
+        ++(ok ? passed : failed);
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// biquad_filter_module, the double TDF2 cascade against the biquad_d1 chain it replaces
+
+struct FilterTest {
+    const char* name;
+    float freq;
+    int mode;
+    Tolerance tolerance;
+};
+
+// bass cutoffs are where a float cascade falls apart, 1.5e-2 off (32 dB) at 20 Hz, the double one is within rounding
+static const FilterTest kFilterTests[] = {
+    { "lp36-20Hz",   20.f,   dsp::biquad_filter_module::mode_36db_lp, { 2e-7, 140.0 } },
+    { "lp36-40Hz",   40.f,   dsp::biquad_filter_module::mode_36db_lp, { 2e-7, 140.0 } },
+    { "lp36-1kHz",   1000.f, dsp::biquad_filter_module::mode_36db_lp, { 2e-7, 140.0 } },
+    { "hp24-20Hz",   20.f,   dsp::biquad_filter_module::mode_24db_hp, { 2e-7, 140.0 } },
+};
+
+static void check_filters(const std::string& filter, bool verbose, int& passed, int& failed)
+{
+    // a 30 Hz sine over noise, half a second each, then both together
+    std::vector<float> in_l(kFrames), in_r(kFrames);
+    uint32_t seed = 0x2545f491;
+    for (uint32_t i = 0; i < kFrames; ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        const float noise = seed * (1.0f / 4294967296.0f) - 0.5f;
+        const float sine = 0.5f * std::sin(2.f * M_PI * 30.f * i / kSampleRate);
+        in_l[i] = i < kFrames / 2 ? sine : sine + noise;
+        in_r[i] = i < kFrames / 2 ? noise : 0.5f * sine;
+    }
+
+    for (const FilterTest& test : kFilterTests)
+    {
+        const std::string label = std::string("biquad_filter_module:") + test.name;
+        if (label.find(filter) == std::string::npos)
+            continue;
+
+        dsp::biquad_filter_module module;
+        module.srate = kSampleRate;
+        module.calculate_filter(test.freq, 0.707f, test.mode);
+        module.filter_activate();
+
+        // the coefficients the module computes, one biquad_d1 per section and channel
+        const int order = test.mode % 3 + 1;
+        dsp::biquad_d1 ref[2][3];
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int j = 0; j < order; ++j)
+            {
+                if (test.mode <= dsp::biquad_filter_module::mode_36db_lp)
+                    ref[c][j].set_lp_rbj(test.freq, pow(0.707f, 1.0 / order), kSampleRate);
+                else
+                    ref[c][j].set_hp_rbj(test.freq, pow(0.707f, 1.0 / order), kSampleRate);
+            }
+        }
+
+        std::vector<float> out_l(kFrames), out_r(kFrames);
+        for (uint32_t i = 0; i < kFrames; i += kBlockSize)
+        {
+            const uint32_t n = std::min(kBlockSize, kFrames - i);
+            module.process_stereo(&in_l[i], &in_r[i], &out_l[i], &out_r[i], n);
+        }
+
+        double max_abs = 0.0, signal = 0.0, error = 0.0;
+        for (uint32_t i = 0; i < kFrames; ++i)
+        {
+            float l = in_l[i], r = in_r[i];
+            for (int j = 0; j < order; ++j)
+            {
+                l = ref[0][j].process(l);
+                r = ref[1][j].process(r);
+            }
+            for (const auto& [expected, out] : { std::make_pair(l, out_l[i]), std::make_pair(r, out_r[i]) })
+            {
+                max_abs = std::max(max_abs, (double)std::fabs(expected - out));
+                signal += (double)expected * expected;
+                error += (double)(expected - out) * (expected - out);
+            }
+        }
+        const double snr_db = 10.0 * std::log10(signal / std::max(error, 1e-30));
+
+        // and it must still clear its state on silence, the output is then exactly zero
+        const std::vector<float> zeros(kBlockSize, 0.f);
+        uint32_t silent = 0;
+        for (; silent < 2 * kSampleRate; silent += kBlockSize)
+        {
+            module.process_stereo(zeros.data(), zeros.data(), out_l.data(), out_r.data(), kBlockSize);
+            if (std::equal(out_l.begin(), out_l.begin() + kBlockSize, zeros.begin()) &&
+                std::equal(out_r.begin(), out_r.begin() + kBlockSize, zeros.begin()))
+                break;
+        }
+
+        const Tolerance& t = test.tolerance;
+        const bool ok = max_abs <= t.max_abs && snr_db >= t.min_snr_db && silent < 2 * kSampleRate;
+
+        if (! ok || verbose)
+        {
+            std::printf("%s %s: max abs %.3g (<= %.3g), snr %.1f dB (>= %.1f), silent after %.2f s (< 2)\n",
+                        ok ? "PASS" : "FAIL", label.c_str(), max_abs, t.max_abs, snr_db, t.min_snr_db,
+                        (double)silent / kSampleRate);
+        }
+
+        ++(ok ? passed : failed);
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// crossover, block API against the per-frame API and the per-frame biquad_d2 chain it replaced
+
+// a quarter of a second is plenty for splits from 120 Hz up to settle and be tested
+static constexpr uint32_t kCrossoverFrames = kFrames / 4;
+static constexpr int kCrossoverMaxChannels = 8;
+static constexpr float kCrossoverFreqs[] = { 120.f, 800.f, 4000.f };
+static constexpr uint32_t kCrossoverBlockSizes[] = { 1, 17, 63 };
+static constexpr Tolerance kCrossoverTolerance = { 2e-7, 140.0 };
+
+static void setup(dsp::crossover& xo, int channels, int bands, int mode)
+{
+    xo.init(channels, bands, kSampleRate);
+    xo.set_mode(mode);
+    // top down, each split is kept below the one above it
+    for (int b = bands - 2; b >= 0; --b)
+        xo.set_filter(b, kCrossoverFreqs[b], true);
+    for (int b = 0; b < bands; ++b)
+        xo.set_level(b, 1.f - 0.125f * b);
+}
+
+// outputs are band-major like the block API, out[(b * channels + c) * kCrossoverFrames + i]
+static void render_frames(int channels, int bands, int mode, const std::vector<float>* in,
+                          std::vector<float>& out, std::vector<float>& ref)
+{
+    dsp::crossover xo;
+    setup(xo, channels, bands, mode);
+
+    // the original per-frame chain, on copies of the coefficients
+    dsp::biquad_d2 lp[kCrossoverMaxChannels][3][4], hp[kCrossoverMaxChannels][3][4];
+    for (int c = 0; c < channels; ++c)
+    {
+        for (int b = 0; b + 1 < bands; ++b)
+        {
+            for (int f = 0; f < 4; ++f)
+            {
+                lp[c][b][f].copy_coeffs(xo.lp[0][b][f]);
+                hp[c][b][f].copy_coeffs(xo.hp[0][b][f]);
+            }
+        }
+    }
+
+    out.assign(channels * bands * kCrossoverFrames, 0.f);
+    ref.assign(channels * bands * kCrossoverFrames, 0.f);
+    for (uint32_t i = 0; i < kCrossoverFrames; ++i)
+    {
+        float data[kCrossoverMaxChannels];
+        for (int c = 0; c < channels; ++c)
+            data[c] = in[c][i];
+        xo.process(data);
+
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int b = 0; b < bands; ++b)
+            {
+                float x = data[c];
+                for (int f = 0; f < xo.get_filter_count(); ++f)
+                {
+                    if (b + 1 < bands)
+                        x = lp[c][b][f].process(x);
+                    if (b > 0)
+                        x = hp[c][b - 1][f].process(x);
+                }
+                out[(b * channels + c) * kCrossoverFrames + i] = xo.get_value(c, b);
+                ref[(b * channels + c) * kCrossoverFrames + i] = x * xo.level[b];
+            }
+        }
+    }
+}
+
+static void render_blocks(int channels, int bands, int mode, uint32_t block_size, const std::vector<float>* in,
+                          std::vector<float>& out)
+{
+    dsp::crossover xo;
+    setup(xo, channels, bands, mode);
+
+    out.assign(channels * bands * kCrossoverFrames, 0.f);
+    for (uint32_t i = 0; i < kCrossoverFrames; i += block_size)
+    {
+        const float* ins[kCrossoverMaxChannels];
+        float* outs[kCrossoverMaxChannels * 4];
+        for (int c = 0; c < channels; ++c)
+            ins[c] = &in[c][i];
+        for (int l = 0; l < channels * bands; ++l)
+            outs[l] = &out[l * kCrossoverFrames + i];
+        xo.process(ins, outs, std::min(block_size, kCrossoverFrames - i));
+    }
+}
+
+static void check_crossover(const std::string& filter, bool verbose, int& passed, int& failed)
+{
+    // noise over a different sine per channel, from the bass range up
+    std::vector<float> in[kCrossoverMaxChannels];
+    uint32_t seed = 0x6c8e9cf5;
+    for (int c = 0; c < kCrossoverMaxChannels; ++c)
+    {
+        in[c].resize(kCrossoverFrames);
+        for (uint32_t i = 0; i < kCrossoverFrames; ++i)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            const float noise = seed * (1.0f / 4294967296.0f) - 0.5f;
+            in[c][i] = 0.5f * std::sin(2.f * M_PI * 40.f * (c + 1) * i / kSampleRate) + 0.25f * noise;
+        }
+    }
+
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        for (int bands = 2; bands <= 4; ++bands)
+        {
+            char label[64];
+            std::snprintf(label, sizeof(label), "crossover:mode%d-%dbands", mode, bands);
+            if (std::string(label).find(filter) == std::string::npos)
+                continue;
+
+            // worst case over 1 to 8 channels, the block API must match the frame API exactly at any block size
+            bool same = true;
+            double max_abs = 0.0, snr_db = 1e3;
+            for (int channels = 1; channels <= kCrossoverMaxChannels; ++channels)
+            {
+                std::vector<float> out, ref;
+                render_frames(channels, bands, mode, in, out, ref);
+
+                for (const uint32_t block_size : kCrossoverBlockSizes)
+                {
+                    std::vector<float> block;
+                    render_blocks(channels, bands, mode, block_size, in, block);
+                    same = same && block == out;
+                }
+
+                double signal = 0.0, error = 0.0;
+                for (size_t i = 0; i < out.size(); ++i)
+                {
+                    max_abs = std::max(max_abs, (double)std::fabs(ref[i] - out[i]));
+                    signal += (double)ref[i] * ref[i];
+                    error += (double)(ref[i] - out[i]) * (ref[i] - out[i]);
+                }
+                snr_db = std::min(snr_db, 10.0 * std::log10(signal / std::max(error, 1e-30)));
+            }
+            if (! same)
+            {
+                std::printf("FAIL %s: block output differs from the frame output\n", label);
+                ++failed;
+                continue;
+            }
+
+            const Tolerance& t = kCrossoverTolerance;
+            const bool ok = max_abs <= t.max_abs && snr_db >= t.min_snr_db;
+
+            if (! ok || verbose)
+            {
+                std::printf("%s %s: max abs %.3g (<= %.3g), snr %.1f dB (>= %.1f)\n",
+                            ok ? "PASS" : "FAIL", label, max_abs, t.max_abs, snr_db, t.min_snr_db);
+            }
+
+            ++(ok ? passed : failed);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// PhasorI, phase drift against the float phasors it replaces
+
+// 10 minutes
+static constexpr uint32_t kPhasorFrames = kSampleRate * 600;
+static constexpr float kPhasorRates[] = { 0.1f, 5.5f, 20.f };
+
+// distance in cycles, 0.5 is fully out of phase
+static double phase_error(double phase, long double reference)
+{
+    const double d = std::fabs(phase - (double)reference);
+    return std::min(d, 1.0 - d);
+}
+
+static void check_phasors(const std::string& filter, bool verbose, int& passed, int& failed)
+{
+    for (const float rate : kPhasorRates)
+    {
+        char label[64];
+        std::snprintf(label, sizeof(label), "PhasorI:drift-%gHz", rate);
+        if (std::string(label).find(filter) == std::string::npos)
+            continue;
+
+        const float invsamplerate = 1.f / kSampleRate;
+        const long double increment = (long double)rate / kSampleRate;
+        long double reference = 0;
+
+        Phasor phasor;
+        PhasorF phasor_f;
+        PhasorI phasor_i;
+        phasor_i.freq(rate, invsamplerate);
+
+        double drift = 0.0, drift_f = 0.0, drift_i = 0.0;
+        for (uint32_t i = 0; i < kPhasorFrames; ++i)
+        {
+            reference += increment;
+            if (reference >= 1)
+                reference -= 1;
+            drift = std::max(drift, phase_error(phasor(rate, invsamplerate), reference));
+            drift_f = std::max(drift_f, phase_error(phasor_f(rate, invsamplerate), reference));
+            drift_i = std::max(drift_i, phase_error(phasor_i(), reference));
+        }
+
+        const bool ok = drift_i <= drift && drift_i <= drift_f;
+
+        if (! ok || verbose)
+        {
+            std::printf("%s %s: max drift %.3g cycles (<= Phasor %.3g, PhasorF %.3g)\n",
+                        ok ? "PASS" : "FAIL", label, drift_i, drift, drift_f);
+        }
+
+        ++(ok ? passed : failed);
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options]\n"
+                 "  -u, --filter TEXT     only tests whose name contains TEXT\n"
+                 "  -v, --verbose         print metrics for passing tests too\n",
+                 argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    bool verbose = false;
+
+    static const option long_options[] = {
+        { "filter", required_argument, nullptr, 'u' },
+        { "verbose", no_argument, nullptr, 'v' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    for (int c; (c = getopt_long(argc, argv, "u:vh", long_options, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'u':
+            filter = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    int passed = 0, failed = 0;
+
+    check_limiter(filter, verbose, passed, failed);
+    check_filters(filter, verbose, passed, failed);
+    check_crossover(filter, verbose, passed, failed);
+    check_phasors(filter, verbose, passed, failed);
+
+    std::printf("%d passed, %d failed\n", passed, failed);
+    return failed == 0 && passed != 0 ? 0 : 1;
+}
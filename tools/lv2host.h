@@ -0,0 +1,415 @@
+/*
+ * Minimal offline LV2 host, shared by the tools in this folder.
+ *
+ * It only understands what the bundles in this repository use: a manifest.ttl with lv2:binary,
+ * and a plugin.ttl with audio and control ports written out as blank nodes.
+ * This is not a general purpose turtle parser, use lilv for anything more involved.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#pragma once
+
+#include <lv2/core/lv2.h>
+
+#include <dlfcn.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lv2host {
+
+struct Port {
+    uint32_t index = 0;
+    std::string symbol;
+    bool audio = false;
+    bool input = false;
+    // integer, enumeration or toggled, only whole values are valid
+    bool integer = false;
+    float def = 0.f;
+    float min = 0.f;
+    float max = 1.f;
+};
+
+struct PluginInfo {
+    std::string uri;
+    std::vector<Port> ports;
+
+    uint32_t count(bool audio, bool input) const
+    {
+        uint32_t n = 0;
+        for (const Port& port : ports)
+            if (port.audio == audio && port.input == input)
+                ++n;
+        return n;
+    }
+
+    const Port* find(const std::string& symbol) const
+    {
+        for (const Port& port : ports)
+            if (port.symbol == symbol)
+                return &port;
+        return nullptr;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// turtle scanning, good enough for the ttl files in this repository
+
+static inline std::string read_file(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+// returns the position right after the blank node or statement starting at pos, nested nodes included
+static inline size_t skip_node(const std::string& ttl, size_t pos, char end)
+{
+    int depth = 0;
+    bool quoted = false;
+
+    for (; pos < ttl.size(); ++pos)
+    {
+        const char c = ttl[pos];
+
+        if (quoted)
+        {
+            quoted = c != '"';
+            continue;
+        }
+
+        switch (c)
+        {
+        case '"':
+            quoted = true;
+            break;
+        case '[':
+            ++depth;
+            break;
+        case ']':
+            if (--depth == 0 && end == ']')
+                return pos + 1;
+            break;
+        case '.':
+            // a statement ends with a dot outside of any blank node and not within a number
+            if (depth == 0 && end == '.' && (pos + 1 == ttl.size() || std::isspace((unsigned char)ttl[pos + 1])))
+                return pos + 1;
+            break;
+        }
+    }
+
+    return ttl.size();
+}
+
+// value following a predicate within text, empty if not present
+static inline std::string find_value(const std::string& text, const char* predicate)
+{
+    const size_t len = std::strlen(predicate);
+
+    for (size_t pos = text.find(predicate); pos != std::string::npos; pos = text.find(predicate, pos + len))
+    {
+        // must be a whole token, lv2:index is not lv2:indexes
+        if (! std::isspace((unsigned char)text[pos + len]))
+            continue;
+
+        size_t start = pos + len;
+        while (start < text.size() && std::isspace((unsigned char)text[start]))
+            ++start;
+
+        if (text[start] == '"' || text[start] == '<')
+        {
+            const size_t stop = text.find(text[start] == '"' ? '"' : '>', start + 1);
+            return text.substr(start + 1, stop - start - 1);
+        }
+
+        size_t stop = start;
+        while (stop < text.size() && ! std::isspace((unsigned char)text[stop]) && text[stop] != ';')
+            ++stop;
+        return text.substr(start, stop - start);
+    }
+
+    return std::string();
+}
+
+static inline bool has_token(const std::string& text, const char* token)
+{
+    const size_t len = std::strlen(token);
+
+    for (size_t pos = text.find(token); pos != std::string::npos; pos = text.find(token, pos + len))
+    {
+        const char next = pos + len < text.size() ? text[pos + len] : ' ';
+        if (std::isspace((unsigned char)next) || next == ',' || next == ';')
+            return true;
+    }
+
+    return false;
+}
+
+// lists the plugins described in a bundle, ports are sorted by index
+static inline std::vector<PluginInfo> parse_bundle(const std::string& bundle)
+{
+    std::vector<PluginInfo> plugins;
+    const std::string ttl = read_file(bundle + "/plugin.ttl");
+
+    for (size_t pos = ttl.find('<'); pos != std::string::npos; pos = ttl.find('<', pos))
+    {
+        // only subjects at the start of a line
+        if (pos != 0 && ttl[pos - 1] != '\n')
+        {
+            ++pos;
+            continue;
+        }
+
+        const size_t uri_end = ttl.find('>', pos);
+        const size_t stmt_end = skip_node(ttl, uri_end, '.');
+        const std::string stmt = ttl.substr(uri_end + 1, stmt_end - uri_end - 1);
+
+        if (has_token(stmt.substr(0, stmt.find(';')), "lv2:Plugin"))
+        {
+            PluginInfo plugin;
+            plugin.uri = ttl.substr(pos + 1, uri_end - pos - 1);
+
+            for (size_t p = stmt.find("lv2:port"); p != std::string::npos;)
+            {
+                p = stmt.find('[', p);
+                if (p == std::string::npos)
+                    break;
+
+                const size_t node_end = skip_node(stmt, p, ']');
+                const std::string node = stmt.substr(p, node_end - p);
+
+                Port port;
+                port.index = std::strtoul(find_value(node, "lv2:index").c_str(), nullptr, 10);
+                port.symbol = find_value(node, "lv2:symbol");
+                port.audio = has_token(node, "lv2:AudioPort");
+                port.input = has_token(node, "lv2:InputPort");
+                port.integer = has_token(node, "lv2:integer") || has_token(node, "lv2:toggled");
+                port.def = std::strtof(find_value(node, "lv2:default").c_str(), nullptr);
+                port.min = std::strtof(find_value(node, "lv2:minimum").c_str(), nullptr);
+                port.max = std::strtof(find_value(node, "lv2:maximum").c_str(), nullptr);
+                plugin.ports.push_back(port);
+
+                // another port follows only after a comma
+                p = stmt.find_first_not_of(" \t\r\n", node_end);
+                if (p == std::string::npos || stmt[p] != ',')
+                    break;
+            }
+
+            std::vector<Port> sorted(plugin.ports.size());
+            for (const Port& port : plugin.ports)
+                if (port.index < sorted.size())
+                    sorted[port.index] = port;
+            plugin.ports.swap(sorted);
+
+            plugins.push_back(plugin);
+        }
+
+        pos = stmt_end;
+    }
+
+    return plugins;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// plugin binary
+
+struct Library {
+    void* handle = nullptr;
+    LV2_Descriptor_Function descriptor_function = nullptr;
+
+    explicit Library(const std::string& bundle)
+    {
+        std::string binary = find_value(read_file(bundle + "/manifest.ttl"), "lv2:binary");
+        if (binary.empty())
+            binary = "plugin.so";
+
+        const std::string path = bundle + "/" + binary;
+        handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+        if (handle == nullptr)
+        {
+            std::fprintf(stderr, "failed to load %s: %s\n", path.c_str(), dlerror());
+            return;
+        }
+
+        descriptor_function = reinterpret_cast<LV2_Descriptor_Function>(dlsym(handle, "lv2_descriptor"));
+    }
+
+    ~Library()
+    {
+        if (handle != nullptr)
+            dlclose(handle);
+    }
+
+    Library(const Library&) = delete;
+    Library& operator=(const Library&) = delete;
+
+    const LV2_Descriptor* find(const std::string& uri) const
+    {
+        if (descriptor_function == nullptr)
+            return nullptr;
+
+        for (uint32_t i = 0;; ++i)
+        {
+            const LV2_Descriptor* const desc = descriptor_function(i);
+            if (desc == nullptr)
+                return nullptr;
+            if (uri == desc->URI)
+                return desc;
+        }
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// plugin instance, with every port connected to host-owned memory
+
+struct Instance {
+    const LV2_Descriptor* desc;
+    const PluginInfo& info;
+    LV2_Handle handle;
+    uint32_t max_block_size;
+
+    std::vector<float> controls;
+    std::vector<std::vector<float>> audio_ins;
+    std::vector<std::vector<float>> audio_outs;
+    // audio port indexes, in order
+    std::vector<uint32_t> audio_in_ports;
+    std::vector<uint32_t> audio_out_ports;
+
+    Instance(const LV2_Descriptor* desc_, const PluginInfo& info_, double sample_rate, uint32_t max_block_size_,
+             const LV2_Feature* const* features = nullptr)
+        : desc(desc_),
+          info(info_),
+          handle(nullptr),
+          max_block_size(max_block_size_),
+          controls(info.ports.size(), 0.f)
+    {
+        static const LV2_Feature* const no_features[] = { nullptr };
+
+        handle = desc->instantiate(desc, sample_rate, "", features != nullptr ? features : no_features);
+        if (handle == nullptr)
+            return;
+
+        for (const Port& port : info.ports)
+        {
+            if (port.audio)
+            {
+                std::vector<std::vector<float>>& buffers = port.input ? audio_ins : audio_outs;
+                (port.input ? audio_in_ports : audio_out_ports).push_back(port.index);
+                buffers.emplace_back(max_block_size, 0.f);
+                desc->connect_port(handle, port.index, buffers.back().data());
+            }
+            else
+            {
+                controls[port.index] = port.def;
+                desc->connect_port(handle, port.index, &controls[port.index]);
+            }
+        }
+    }
+
+    ~Instance()
+    {
+        if (handle != nullptr)
+            desc->cleanup(handle);
+    }
+
+    Instance(const Instance&) = delete;
+    Instance& operator=(const Instance&) = delete;
+
+    bool set_control(const std::string& symbol, float value)
+    {
+        const Port* const port = info.find(symbol);
+        if (port == nullptr || port->audio)
+            return false;
+        controls[port->index] = value;
+        return true;
+    }
+
+    float get_control(const std::string& symbol) const
+    {
+        const Port* const port = info.find(symbol);
+        return port != nullptr && ! port->audio ? controls[port->index] : 0.f;
+    }
+
+    // connect the audio ports to external memory, outputs may alias inputs for in-place processing
+    void connect_audio(const float* const* ins, float* const* outs)
+    {
+        for (size_t i = 0; i < audio_in_ports.size(); ++i)
+            desc->connect_port(handle, audio_in_ports[i], const_cast<float*>(ins[i]));
+        for (size_t i = 0; i < audio_out_ports.size(); ++i)
+            desc->connect_port(handle, audio_out_ports[i], outs[i]);
+    }
+
+    // back to the buffers owned by this instance
+    void connect_internal_audio()
+    {
+        for (size_t i = 0; i < audio_in_ports.size(); ++i)
+            desc->connect_port(handle, audio_in_ports[i], audio_ins[i].data());
+        for (size_t i = 0; i < audio_out_ports.size(); ++i)
+            desc->connect_port(handle, audio_out_ports[i], audio_outs[i].data());
+    }
+
+    void activate()
+    {
+        if (desc->activate != nullptr)
+            desc->activate(handle);
+    }
+
+    void deactivate()
+    {
+        if (desc->deactivate != nullptr)
+            desc->deactivate(handle);
+    }
+
+    void run(uint32_t nframes)
+    {
+        desc->run(handle, nframes);
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// command line helpers
+
+// splits "a,b,c" into its items
+static inline std::vector<std::string> split(const std::string& text, char separator = ',')
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+
+    for (size_t pos; (pos = text.find(separator, start)) != std::string::npos; start = pos + 1)
+        items.push_back(text.substr(start, pos - start));
+
+    items.push_back(text.substr(start));
+    return items;
+}
+
+// applies "symbol=value,symbol=value" control settings, returns false on unknown symbols
+static inline bool apply_controls(Instance& instance, const std::string& settings)
+{
+    if (settings.empty())
+        return true;
+
+    for (const std::string& item : split(settings))
+    {
+        const size_t eq = item.find('=');
+        if (eq == std::string::npos || ! instance.set_control(item.substr(0, eq), std::strtof(item.c_str() + eq + 1, nullptr)))
+        {
+            std::fprintf(stderr, "%s: unknown control setting '%s'\n", instance.info.uri.c_str(), item.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
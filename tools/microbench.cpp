@@ -0,0 +1,791 @@
+/*
+ * Microbenchmarks for the DSP primitives in dsp-calf and dsp-genlib.
+ *
+ * Each primitive is timed on its own, over a buffer of noise, both at steady state (fixed parameters)
+ * and under parameter modulation (parameters swept by an LFO while running).
+ * Stateless functions only have a single "stateless" mode.
+ * Filters are also fed a short burst followed by silence, so their state decays through the denormal range,
+ * once with IEEE denormals ("decaying") and once under darkglass::scoped_flush_denormals ("decaying-ftz").
+ * Built with the same flags as the plugins, so the numbers match what the plugins get.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+#include <getopt.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// calf first, genlib defines a few macros that are best kept out of the standard headers
+#include "audio_fx.cpp"
+#include "biquad.h"
+#include "delay.h"
+#include "fixed_point.h"
+#include "inertia.h"
+#include "onepole.h"
+
+#include "denormals.h"
+
+#include "genlib.cpp"
+#include "genlib_ops.h"
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static constexpr float kSampleRate = 48000.f;
+// parameter changes for primitives that are normally updated at control rate, as in simple_phaser
+static constexpr int kControlInterval = 32;
+// block size for the primitives with a block API
+static constexpr int kBlockSize = 128;
+// minimum warm-up time per benchmark
+static constexpr double kMinWarmupNs = 50e6;
+
+// length of the noise burst at the start of the decaying signal, 10 ms
+static constexpr int kBurstSamples = 480;
+
+// shared inputs: white noise as the signal, a 10 Hz sine in [0, 1) as the modulation source,
+// and a noise burst followed by silence for the decaying benchmarks
+struct Inputs {
+    std::vector<float> signal;
+    std::vector<float> mod;
+    std::vector<float> decay;
+
+    explicit Inputs(int samples)
+        : signal(samples),
+          mod(samples),
+          decay(samples, 0.f)
+    {
+        uint32_t seed = 0x9e3779b9;
+        for (int i = 0; i < samples; ++i)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            signal[i] = seed * (1.0f / 4294967296.0f) - 0.5f;
+            mod[i] = 0.5f + 0.5f * std::sin(2.0 * M_PI * 10.0 * i / kSampleRate);
+        }
+        std::copy_n(signal.begin(), std::min(samples, kBurstSamples), decay.begin());
+    }
+};
+
+struct Benchmark {
+    const char* name;
+    const char* mode;
+    // processes the whole input once and returns something derived from every output, so nothing is optimised out
+    std::function<double(const Inputs&)> run;
+};
+
+// a stateless function over the signal mapped by scale and offset, templated so the call is inlined
+template<float (*Fn)(float)>
+static Benchmark stateless(const char* name, float scale, float offset)
+{
+    return { name, "stateless", [scale, offset](const Inputs& in) {
+        double acc = 0;
+        for (size_t i = 0; i < in.signal.size(); ++i)
+            acc += Fn(in.signal[i] * scale + offset);
+        return acc;
+    }};
+}
+
+// a filter over the decaying signal, with denormals as IEEE has them and then flushed to zero
+template<class Fn>
+static void decaying(std::vector<Benchmark>& b, const char* name, Fn fn)
+{
+    b.push_back({ name, "decaying", [fn](const Inputs& in) mutable {
+        return fn(in.decay);
+    }});
+    b.push_back({ name, "decaying-ftz", [fn](const Inputs& in) mutable {
+        const darkglass::scoped_flush_denormals flush_denormals;
+        return fn(in.decay);
+    }});
+}
+
+// the noise limited by 6 dB or so, one frame at a time and in blocks
+static void limiter(std::vector<Benchmark>& b, const char* name, float attack_ms)
+{
+    const auto make = [attack_ms]() {
+        auto l = std::make_shared<dsp::lookahead_limiter>();
+        l->set_sample_rate(kSampleRate);
+        l->set_params(0.25f, attack_ms, 50.f);
+        l->reset();
+        return l;
+    };
+    b.push_back({ name, "frame", [l = make()](const Inputs& in) {
+        double acc = 0;
+        for (size_t i = 0; i < in.signal.size(); ++i)
+        {
+            float left = in.signal[i], right = in.mod[i] - 0.5f;
+            l->process(left, right, nullptr);
+            acc += left + right;
+        }
+        return acc;
+    }});
+    b.push_back({ name, "block", [l = make()](const Inputs& in) {
+        float right_in[kBlockSize], outs[2][kBlockSize];
+        double acc = 0;
+        for (size_t i = 0; i < in.signal.size(); i += kBlockSize)
+        {
+            const uint32_t n = std::min<size_t>(kBlockSize, in.signal.size() - i);
+            for (uint32_t k = 0; k < n; ++k)
+                right_in[k] = in.mod[i + k] - 0.5f;
+            const float* const ins[2] = { &in.signal[i], right_in };
+            float* const outp[2] = { outs[0], outs[1] };
+            l->process(ins, outp, n);
+            for (uint32_t k = 0; k < n; ++k)
+                acc += outs[0][k] + outs[1][k];
+        }
+        return acc;
+    }});
+}
+
+static std::vector<Benchmark> make_benchmarks()
+{
+    std::vector<Benchmark> b;
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // dsp-calf
+
+    // fills the static table used by the lerp_by_fract_int benchmarks
+    dsp::sine_table<int, 4096, 65536>();
+
+    {
+        dsp::onepole<float> f;
+        f.set_ap(1000.f, kSampleRate);
+        b.push_back({ "calf::onepole::process_ap", "steady", [f](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += f.process_ap(in.signal[i]);
+            return acc;
+        }});
+    }
+    {
+        // per-sample coefficient, as the phaser does with its interpolated a0
+        dsp::onepole<float> f;
+        f.set_ap(1000.f, kSampleRate);
+        b.push_back({ "calf::onepole::process_ap", "modulated", [f](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                f.set_ap_a0(in.mod[i] * 1.8f - 0.9f);
+                acc += f.process_ap(in.signal[i]);
+            }
+            return acc;
+        }});
+    }
+    {
+        dsp::biquad_d1 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        b.push_back({ "calf::biquad_d1::process", "steady", [f](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += f.process(in.signal[i]);
+            return acc;
+        }});
+    }
+    {
+        dsp::biquad_d1 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        b.push_back({ "calf::biquad_d1::process", "modulated", [f](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                if (i % kControlInterval == 0)
+                    f.set_lp_rbj(200.f + 4000.f * in.mod[i], 0.707f, kSampleRate);
+                acc += f.process(in.signal[i]);
+            }
+            return acc;
+        }});
+    }
+    {
+        dsp::biquad_d2 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        b.push_back({ "calf::biquad_d2::process", "steady", [f](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += f.process(in.signal[i]);
+            return acc;
+        }});
+    }
+    {
+        dsp::biquad_d2 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        b.push_back({ "calf::biquad_d2::process", "modulated", [f](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                if (i % kControlInterval == 0)
+                    f.set_lp_rbj(200.f + 4000.f * in.mod[i], 0.707f, kSampleRate);
+                acc += f.process(in.signal[i]);
+            }
+            return acc;
+        }});
+    }
+    {
+        // 36 dB/oct lowpass on two channels in blocks, as biquad_filter_module did it before the cascade
+        dsp::biquad_d1 l[3], r[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            l[j].set_lp_rbj(1000.f, 0.9f, kSampleRate);
+            r[j].copy_coeffs(l[j]);
+        }
+        b.push_back({ "calf::biquad_d1 x3 stereo", "steady", [l, r](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                const float outl = l[2].process(l[1].process(l[0].process(in.signal[i])));
+                const float outr = r[2].process(r[1].process(r[0].process(in.mod[i])));
+                acc += outl + outr;
+            }
+            return acc;
+        }});
+    }
+    {
+        dsp::biquad_tdf2_cascade<double, 3> f;
+        dsp::biquad_coeffs c;
+        c.set_lp_rbj(1000.f, 0.9f, kSampleRate);
+        f.set_sections(3);
+        for (int j = 0; j < 3; ++j)
+            f.set_coeffs(j, c);
+        b.push_back({ "calf::biquad_tdf2_cascade::process_stereo", "steady", [f](const Inputs& in) mutable {
+            float outl[kBlockSize], outr[kBlockSize];
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); i += kBlockSize)
+            {
+                const uint32_t n = std::min<size_t>(kBlockSize, in.signal.size() - i);
+                f.process_stereo(&in.signal[i], &in.mod[i], outl, outr, n);
+                for (uint32_t k = 0; k < n; ++k)
+                    acc += outl[k] + outr[k];
+            }
+            return acc;
+        }});
+        b.push_back({ "calf::biquad_tdf2_cascade::process_channel x2", "steady", [f](const Inputs& in) mutable {
+            float outl[kBlockSize], outr[kBlockSize];
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); i += kBlockSize)
+            {
+                const uint32_t n = std::min<size_t>(kBlockSize, in.signal.size() - i);
+                f.process_channel(0, &in.signal[i], outl, n);
+                f.process_channel(1, &in.mod[i], outr, n);
+                for (uint32_t k = 0; k < n; ++k)
+                    acc += outl[k] + outr[k];
+            }
+            return acc;
+        }});
+    }
+    {
+        dsp::onepole<float> f;
+        f.set_ap(100.f, kSampleRate);
+        decaying(b, "calf::onepole::process_ap", [f](const std::vector<float>& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.size(); ++i)
+                acc += f.process_ap(in[i]);
+            return acc;
+        });
+    }
+    {
+        dsp::biquad_d1 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        decaying(b, "calf::biquad_d1::process", [f](const std::vector<float>& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.size(); ++i)
+                acc += f.process(in[i]);
+            return acc;
+        });
+    }
+    {
+        // sanitizes its input and state on every sample, so it never sees denormals either way
+        dsp::biquad_d2 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        decaying(b, "calf::biquad_d2::process", [f](const std::vector<float>& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.size(); ++i)
+                acc += f.process(in[i]);
+            return acc;
+        });
+    }
+    {
+        dsp::biquad_d2 f;
+        f.set_lp_rbj(1000.f, 0.707f, kSampleRate);
+        decaying(b, "calf::biquad_d2::process_nosanitize", [f](const std::vector<float>& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.size(); ++i)
+                acc += f.process_nosanitize(in[i]);
+            return acc;
+        });
+    }
+    {
+        dsp::inertia<dsp::linear_ramp> v(dsp::linear_ramp(64), 0.5f);
+        b.push_back({ "calf::inertia<linear_ramp>::get", "steady", [v](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += v.get() * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        // a new target every control interval, shorter than the ramp, so it is always ramping
+        dsp::inertia<dsp::linear_ramp> v(dsp::linear_ramp(64), 0.5f);
+        b.push_back({ "calf::inertia<linear_ramp>::get", "modulated", [v](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += v.get(in.mod[i - i % kControlInterval]) * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        dsp::switcher<int> s(64);
+        b.push_back({ "calf::switcher::get_ramp", "steady", [s](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += s.get_ramp() * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        // switching every 256 samples, each switch ramps down and up again over 64 samples
+        dsp::switcher<int> s(64);
+        b.push_back({ "calf::switcher::get_ramp", "modulated", [s](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                if (i % 256 == 0)
+                    s.set(int(i / 256));
+                acc += s.get_ramp() * in.signal[i];
+            }
+            return acc;
+        }});
+    }
+    {
+        dsp::simple_delay<1024, float> d;
+        b.push_back({ "calf::simple_delay::get_interp", "steady", [d](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                float out;
+                d.put(in.signal[i]);
+                d.get_interp(out, 100, 0.25f);
+                acc += out;
+            }
+            return acc;
+        }});
+    }
+    {
+        // chorus-style delay sweep, a new fractional position every sample
+        dsp::simple_delay<1024, float> d;
+        b.push_back({ "calf::simple_delay::get_interp", "modulated", [d](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                const float pos = 50.f + 900.f * in.mod[i];
+                const int ipos = int(pos);
+                float out;
+                d.put(in.signal[i]);
+                d.get_interp(out, ipos, pos - ipos);
+                acc += out;
+            }
+            return acc;
+        }});
+    }
+    {
+        // table LFO as in the calf chorus
+        dsp::fixed_point<unsigned int, 20> phase(0.0), dphase(0.0);
+        dphase = 4096.0 * 0.5 / kSampleRate;
+        b.push_back({ "calf::fixed_point::lerp_by_fract_int", "steady", [phase, dphase](const Inputs& in) mutable {
+            using table = dsp::sine_table<int, 4096, 65536>;
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                const int ipart = phase.ipart();
+                acc += phase.lerp_by_fract_int<int, 14, int>(table::data[ipart], table::data[ipart + 1]);
+                phase += dphase;
+            }
+            return acc;
+        }});
+    }
+    {
+        dsp::fixed_point<unsigned int, 20> phase(0.0);
+        b.push_back({ "calf::fixed_point::lerp_by_fract_int", "modulated", [phase](const Inputs& in) mutable {
+            using table = dsp::sine_table<int, 4096, 65536>;
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                dsp::fixed_point<unsigned int, 20> dphase(4096.0 * (0.1 + 10.0 * in.mod[i]) / kSampleRate);
+                const int ipart = phase.ipart();
+                acc += phase.lerp_by_fract_int<int, 14, int>(table::data[ipart], table::data[ipart + 1]);
+                phase += dphase;
+            }
+            return acc;
+        }});
+    }
+
+    {
+        // 8 channels split into 4 bands with 24 dB/oct Linkwitz-Riley filters, one interleaved frame at a time
+        auto x = std::make_shared<dsp::crossover>();
+        x->init(8, 4, kSampleRate);
+        x->set_mode(1);
+        x->set_filter(2, 4000.f);
+        x->set_filter(1, 800.f);
+        x->set_filter(0, 120.f);
+        b.push_back({ "calf::crossover::process 8ch 4 bands", "frame", [x](const Inputs& in) {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                float frame[8];
+                for (int c = 0; c < 8; ++c)
+                    frame[c] = c & 1 ? in.mod[i] : in.signal[i];
+                x->process(frame);
+                for (int c = 0; c < 8; ++c)
+                    for (int band = 0; band < 4; ++band)
+                        acc += x->get_value(c, band);
+            }
+            return acc;
+        }});
+    }
+    {
+        auto x = std::make_shared<dsp::crossover>();
+        x->init(8, 4, kSampleRate);
+        x->set_mode(1);
+        x->set_filter(2, 4000.f);
+        x->set_filter(1, 800.f);
+        x->set_filter(0, 120.f);
+        b.push_back({ "calf::crossover::process 8ch 4 bands", "block", [x](const Inputs& in) {
+            float outs[4][8][kBlockSize];
+            const float* ins[8];
+            float* outp[32];
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); i += kBlockSize)
+            {
+                const uint32_t n = std::min<size_t>(kBlockSize, in.signal.size() - i);
+                for (int c = 0; c < 8; ++c)
+                {
+                    ins[c] = c & 1 ? &in.mod[i] : &in.signal[i];
+                    for (int band = 0; band < 4; ++band)
+                        outp[band * 8 + c] = outs[band][c];
+                }
+                x->process(ins, outp, n);
+                for (int c = 0; c < 8; ++c)
+                    for (int band = 0; band < 4; ++band)
+                        for (uint32_t k = 0; k < n; ++k)
+                            acc += outs[band][c][k];
+            }
+            return acc;
+        }});
+    }
+
+    // the cost of the block engine should not depend on the attack time
+    limiter(b, "calf::lookahead_limiter::process attack 1 ms", 1.f);
+    limiter(b, "calf::lookahead_limiter::process attack 10 ms", 10.f);
+    limiter(b, "calf::lookahead_limiter::process attack 100 ms", 100.f);
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // dsp-genlib
+
+    {
+        Phasor p;
+        b.push_back({ "genlib::Phasor", "steady", [p](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += p(5.5, 1.0 / kSampleRate) * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        Phasor p;
+        b.push_back({ "genlib::Phasor", "modulated", [p](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += p(0.1f + 20.f * in.mod[i], 1.0 / kSampleRate) * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        PhasorF p;
+        b.push_back({ "genlib::PhasorF", "steady", [p](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += p(5.5f, 1.f / kSampleRate) * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        PhasorF p;
+        b.push_back({ "genlib::PhasorF", "modulated", [p](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += p(0.1f + 20.f * in.mod[i], 1.f / kSampleRate) * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        PhasorI p;
+        p.freq(5.5f, 1.f / kSampleRate);
+        b.push_back({ "genlib::PhasorI", "steady", [p](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += p() * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        PhasorI p;
+        p.freq(5.5f, 1.f / kSampleRate);
+        b.push_back({ "genlib::PhasorI", "modulated", [p](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                p.freq(0.1f + 20.f * in.mod[i], 1.f / kSampleRate);
+                acc += p() * in.signal[i];
+            }
+            return acc;
+        }});
+    }
+    {
+        // Delay owns genlib data, keep a single instance alive for the whole run
+        auto d = std::make_shared<Delay>();
+        d->reset("microbench", 1024);
+        b.push_back({ "genlib::Delay::read_cubic", "steady", [d](const Inputs& in) {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                acc += d->read_cubic(100.25);
+                d->write(in.signal[i]);
+                d->step();
+            }
+            return acc;
+        }});
+    }
+    {
+        auto d = std::make_shared<Delay>();
+        d->reset("microbench", 1024);
+        b.push_back({ "genlib::Delay::read_cubic", "modulated", [d](const Inputs& in) {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                acc += d->read_cubic(50.f + 900.f * in.mod[i]);
+                d->write(in.signal[i]);
+                d->step();
+            }
+            return acc;
+        }});
+    }
+    {
+        auto data = std::make_shared<SineData>();
+        SineCycle c;
+        c.reset(kSampleRate);
+        c.freq(440);
+        b.push_back({ "genlib::SineCycle", "steady", [data, c](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+                acc += c(*data) * in.signal[i];
+            return acc;
+        }});
+    }
+    {
+        auto data = std::make_shared<SineData>();
+        SineCycle c;
+        c.reset(kSampleRate);
+        b.push_back({ "genlib::SineCycle", "modulated", [data, c](const Inputs& in) mutable {
+            double acc = 0;
+            for (size_t i = 0; i < in.signal.size(); ++i)
+            {
+                c.freq(100.f + 1000.f * in.mod[i]);
+                acc += c(*data) * in.signal[i];
+            }
+            return acc;
+        }});
+    }
+
+    // stateless approximations, inputs mapped to the range each one is meant for
+    b.push_back(stateless<genlib_fastersin>("genlib::genlib_fastersin", 6.2f, 0.f));
+    b.push_back(stateless<genlib_fastercos>("genlib::genlib_fastercos", 6.2f, 0.f));
+    b.push_back(stateless<genlib_fastersinfull>("genlib::genlib_fastersinfull", 100.f, 0.f));
+    b.push_back(stateless<genlib_fastercosfull>("genlib::genlib_fastercosfull", 100.f, 0.f));
+    b.push_back(stateless<genlib_fastertanfull>("genlib::genlib_fastertanfull", 100.f, 0.f));
+    b.push_back(stateless<genlib_fasterpow2>("genlib::genlib_fasterpow2", 40.f, 0.f));
+    b.push_back(stateless<genlib_fasterexp>("genlib::genlib_fasterexp", 40.f, 0.f));
+    b.push_back(stateless<genlib_fasterlog2>("genlib::genlib_fasterlog2", 1000.f, 500.6f));
+    b.push_back({ "genlib::genlib_fasterpow", "stateless", [](const Inputs& in) {
+        double acc = 0;
+        for (size_t i = 0; i < in.signal.size(); ++i)
+            acc += genlib_fasterpow(in.mod[i] * 10.f + 0.01f, in.signal[i] * 4.f);
+        return acc;
+    }});
+
+    return b;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Stats {
+    double min, median, mean, stddev, max;
+};
+
+static Stats compute_stats(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+
+    Stats s;
+    s.min = values.front();
+    s.max = values.back();
+    s.median = values.size() % 2 ? values[values.size() / 2]
+                                 : 0.5 * (values[values.size() / 2 - 1] + values[values.size() / 2]);
+    s.mean = 0;
+    for (double v : values)
+        s.mean += v;
+    s.mean /= values.size();
+    s.stddev = 0;
+    for (double v : values)
+        s.stddev += (v - s.mean) * (v - s.mean);
+    s.stddev = std::sqrt(s.stddev / values.size());
+    return s;
+}
+
+static inline double now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options]\n"
+                 "  -f, --format FORMAT   csv or json, default csv\n"
+                 "  -u, --filter TEXT     only benchmarks whose name contains TEXT\n"
+                 "  -s, --samples N       samples processed per repetition, default 48000\n"
+                 "                        avoid powers of two, they can alias the filter state on x86\n"
+                 "  -n, --repeat N        timed repetitions, default 25\n"
+                 "  -w, --warmup N        untimed repetitions first, default 3 and at least 50 ms\n"
+                 "  -l, --list            list the benchmarks and exit\n",
+                 argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    // linking with -ffast-math turns flush-to-zero on at startup, but a plugin host may well not,
+    // so measure with IEEE denormals unless a benchmark asks otherwise
+    const darkglass::scoped_flush_denormals ieee_denormals(false);
+
+    std::string format = "csv";
+    std::string filter;
+    int samples = kSampleRate;
+    int repeat = 25;
+    int warmup = 3;
+    bool list = false;
+
+    static const option long_options[] = {
+        { "format", required_argument, nullptr, 'f' },
+        { "filter", required_argument, nullptr, 'u' },
+        { "samples", required_argument, nullptr, 's' },
+        { "repeat", required_argument, nullptr, 'n' },
+        { "warmup", required_argument, nullptr, 'w' },
+        { "list", no_argument, nullptr, 'l' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    for (int c; (c = getopt_long(argc, argv, "f:u:s:n:w:lh", long_options, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'f':
+            format = optarg;
+            break;
+        case 'u':
+            filter = optarg;
+            break;
+        case 's':
+            samples = std::max(kControlInterval, std::atoi(optarg));
+            break;
+        case 'n':
+            repeat = std::max(1, std::atoi(optarg));
+            break;
+        case 'w':
+            warmup = std::max(0, std::atoi(optarg));
+            break;
+        case 'l':
+            list = true;
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    if (format != "csv" && format != "json")
+    {
+        std::fprintf(stderr, "unknown format '%s'\n", format.c_str());
+        return 1;
+    }
+
+    const Inputs inputs(samples);
+    std::vector<Benchmark> benchmarks = make_benchmarks();
+
+    if (list)
+    {
+        for (const Benchmark& bench : benchmarks)
+            if (std::strstr(bench.name, filter.c_str()) != nullptr)
+                std::printf("%s,%s\n", bench.name, bench.mode);
+        return 0;
+    }
+
+    if (format == "csv")
+        std::printf("name,mode,samples,repeat,min_ns,median_ns,mean_ns,stddev_ns,max_ns\n");
+    else
+        std::printf("[\n");
+
+    bool first = true;
+    volatile double sink = 0;
+
+    for (Benchmark& bench : benchmarks)
+    {
+        if (std::strstr(bench.name, filter.c_str()) == nullptr)
+            continue;
+
+        // warm up for a given number of repetitions, and long enough for the cpu clock to settle
+        const double warmup_start = now_ns();
+        for (int i = 0; i < warmup || now_ns() - warmup_start < kMinWarmupNs; ++i)
+            sink = sink + bench.run(inputs);
+
+        // ns per sample of each repetition
+        std::vector<double> times(repeat);
+        for (int i = 0; i < repeat; ++i)
+        {
+            const double start = now_ns();
+            sink = sink + bench.run(inputs);
+            times[i] = (now_ns() - start) / samples;
+        }
+
+        const Stats s = compute_stats(times);
+
+        if (format == "csv")
+        {
+            std::printf("%s,%s,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                        bench.name, bench.mode, samples, repeat, s.min, s.median, s.mean, s.stddev, s.max);
+        }
+        else
+        {
+            std::printf("%s  {\"name\": \"%s\", \"mode\": \"%s\", \"samples\": %d, \"repeat\": %d, "
+                        "\"min_ns\": %.4f, \"median_ns\": %.4f, \"mean_ns\": %.4f, \"stddev_ns\": %.4f, \"max_ns\": %.4f}",
+                        first ? "" : ",\n", bench.name, bench.mode, samples, repeat,
+                        s.min, s.median, s.mean, s.stddev, s.max);
+        }
+
+        first = false;
+        std::fflush(stdout);
+    }
+
+    if (format == "json")
+        std::printf("%s]\n", first ? "" : "\n");
+
+    return 0;
+}
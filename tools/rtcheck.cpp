@@ -0,0 +1,752 @@
+/*
+ * Real-time safety check for the plugin bundles in this repository.
+ *
+ * Every plugin of every bundle given on the command line is instantiated and activated as usual, then run
+ * for a long session with random block sizes, random parameter automation and changing input signals.
+ * Allocations, locks, stdio and blocking syscalls are intercepted by this program, anything called while
+ * the plugin is inside connect_port() or run() is reported together with the address it was called from.
+ *
+ * The interception relies on the plugin binary resolving these symbols against the executable, which needs
+ * glibc (for __libc_malloc and friends) and -rdynamic, so this tool is Linux only.
+ *
+ * Copyright (C) 2026 Darkglass Electronics
+ * SPDX-License-Identifier: ISC
+ */
+
+// the fortified stdio inlines would get in the way of the replacements below
+#undef _FORTIFY_SOURCE
+
+#include "lv2host.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <new>
+#include <random>
+
+// --------------------------------------------------------------------------------------------------------------------
+// violation log, written from within the interceptors so it must not allocate
+
+struct Violation {
+    const char* function;
+    void* caller;
+    uint64_t count;
+};
+
+static constexpr int kMaxViolations = 32;
+
+static Violation g_violations[kMaxViolations];
+static int g_num_violations = 0;
+static uint64_t g_total_violations = 0;
+
+// set only around the calls into the plugin that must be real-time safe
+static thread_local bool t_armed = false;
+
+static void record(const char* function, void* caller)
+{
+    ++g_total_violations;
+
+    for (int i = 0; i < g_num_violations; ++i)
+    {
+        if (g_violations[i].function == function && g_violations[i].caller == caller)
+        {
+            ++g_violations[i].count;
+            return;
+        }
+    }
+
+    if (g_num_violations < kMaxViolations)
+        g_violations[g_num_violations++] = { function, caller, 1 };
+}
+
+#define RT_CHECK(name)                                         \
+    if (t_armed)                                               \
+        record(name, __builtin_return_address(0));
+
+// next definition in lookup order, that is the one from libc
+template <typename Fn>
+static inline Fn next(Fn& cache, const char* name)
+{
+    if (cache == nullptr)
+        cache = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+    return cache;
+}
+
+#define REAL(name) next(real_##name, #name)
+
+// --------------------------------------------------------------------------------------------------------------------
+// interceptors
+
+extern "C" {
+
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+
+// allocation, forwarded straight to glibc as dlsym itself may allocate
+
+void* malloc(size_t size)
+{
+    RT_CHECK("malloc")
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    RT_CHECK("calloc")
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    RT_CHECK("realloc")
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    if (ptr != nullptr)
+    {
+        RT_CHECK("free")
+    }
+    __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    RT_CHECK("memalign")
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    RT_CHECK("aligned_alloc")
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    RT_CHECK("posix_memalign")
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+// locks
+
+static int (*real_pthread_mutex_lock)(pthread_mutex_t*);
+static int (*real_pthread_rwlock_rdlock)(pthread_rwlock_t*);
+static int (*real_pthread_rwlock_wrlock)(pthread_rwlock_t*);
+static int (*real_pthread_cond_wait)(pthread_cond_t*, pthread_mutex_t*);
+static int (*real_pthread_cond_timedwait)(pthread_cond_t*, pthread_mutex_t*, const timespec*);
+static int (*real_sem_wait)(sem_t*);
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    RT_CHECK("pthread_mutex_lock")
+    return REAL(pthread_mutex_lock)(mutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock)
+{
+    RT_CHECK("pthread_rwlock_rdlock")
+    return REAL(pthread_rwlock_rdlock)(rwlock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock)
+{
+    RT_CHECK("pthread_rwlock_wrlock")
+    return REAL(pthread_rwlock_wrlock)(rwlock);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+    RT_CHECK("pthread_cond_wait")
+    return REAL(pthread_cond_wait)(cond, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const timespec* abstime)
+{
+    RT_CHECK("pthread_cond_timedwait")
+    return REAL(pthread_cond_timedwait)(cond, mutex, abstime);
+}
+
+int sem_wait(sem_t* sem)
+{
+    RT_CHECK("sem_wait")
+    return REAL(sem_wait)(sem);
+}
+
+// syscalls
+
+static ssize_t (*real_read)(int, void*, size_t);
+static ssize_t (*real_write)(int, const void*, size_t);
+static int (*real_open)(const char*, int, ...);
+static int (*real_openat)(int, const char*, int, ...);
+static int (*real_close)(int);
+static void* (*real_mmap)(void*, size_t, int, int, int, off_t);
+static int (*real_munmap)(void*, size_t);
+static int (*real_nanosleep)(const timespec*, timespec*);
+static int (*real_usleep)(useconds_t);
+static int (*real_sched_yield)();
+
+ssize_t read(int fd, void* buf, size_t count)
+{
+    RT_CHECK("read")
+    return REAL(read)(fd, buf, count);
+}
+
+ssize_t write(int fd, const void* buf, size_t count)
+{
+    RT_CHECK("write")
+    return REAL(write)(fd, buf, count);
+}
+
+int open(const char* path, int flags, ...)
+{
+    RT_CHECK("open")
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = va_arg(args, mode_t);
+    va_end(args);
+    return REAL(open)(path, flags, mode);
+}
+
+int openat(int dirfd, const char* path, int flags, ...)
+{
+    RT_CHECK("openat")
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = va_arg(args, mode_t);
+    va_end(args);
+    return REAL(openat)(dirfd, path, flags, mode);
+}
+
+int close(int fd)
+{
+    RT_CHECK("close")
+    return REAL(close)(fd);
+}
+
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    RT_CHECK("mmap")
+    return REAL(mmap)(addr, length, prot, flags, fd, offset);
+}
+
+int munmap(void* addr, size_t length)
+{
+    RT_CHECK("munmap")
+    return REAL(munmap)(addr, length);
+}
+
+int nanosleep(const timespec* req, timespec* rem)
+{
+    RT_CHECK("nanosleep")
+    return REAL(nanosleep)(req, rem);
+}
+
+int usleep(useconds_t usec)
+{
+    RT_CHECK("usleep")
+    return REAL(usleep)(usec);
+}
+
+int sched_yield()
+{
+    RT_CHECK("sched_yield")
+    return REAL(sched_yield)();
+}
+
+// stdio, glibc writes through its internal syscall wrappers so write() alone does not see it
+
+static int (*real_vfprintf)(FILE*, const char*, va_list);
+static int (*real___vfprintf_chk)(FILE*, int, const char*, va_list);
+static int (*real_fputs)(const char*, FILE*);
+static int (*real_puts)(const char*);
+static int (*real_fputc)(int, FILE*);
+static size_t (*real_fwrite)(const void*, size_t, size_t, FILE*);
+static int (*real_fflush)(FILE*);
+
+int vfprintf(FILE* stream, const char* format, va_list args)
+{
+    RT_CHECK("vfprintf")
+    return REAL(vfprintf)(stream, format, args);
+}
+
+int fprintf(FILE* stream, const char* format, ...)
+{
+    RT_CHECK("fprintf")
+    va_list args;
+    va_start(args, format);
+    const int ret = REAL(vfprintf)(stream, format, args);
+    va_end(args);
+    return ret;
+}
+
+int printf(const char* format, ...)
+{
+    RT_CHECK("printf")
+    va_list args;
+    va_start(args, format);
+    const int ret = REAL(vfprintf)(stdout, format, args);
+    va_end(args);
+    return ret;
+}
+
+int __vfprintf_chk(FILE* stream, int flag, const char* format, va_list args)
+{
+    RT_CHECK("__vfprintf_chk")
+    return REAL(__vfprintf_chk)(stream, flag, format, args);
+}
+
+int __fprintf_chk(FILE* stream, int flag, const char* format, ...)
+{
+    RT_CHECK("__fprintf_chk")
+    va_list args;
+    va_start(args, format);
+    const int ret = REAL(__vfprintf_chk)(stream, flag, format, args);
+    va_end(args);
+    return ret;
+}
+
+int __printf_chk(int flag, const char* format, ...)
+{
+    RT_CHECK("__printf_chk")
+    va_list args;
+    va_start(args, format);
+    const int ret = REAL(__vfprintf_chk)(stdout, flag, format, args);
+    va_end(args);
+    return ret;
+}
+
+int fputs(const char* str, FILE* stream)
+{
+    RT_CHECK("fputs")
+    return REAL(fputs)(str, stream);
+}
+
+int puts(const char* str)
+{
+    RT_CHECK("puts")
+    return REAL(puts)(str);
+}
+
+int fputc(int c, FILE* stream)
+{
+    RT_CHECK("fputc")
+    return REAL(fputc)(c, stream);
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream)
+{
+    RT_CHECK("fwrite")
+    return REAL(fwrite)(ptr, size, count, stream);
+}
+
+int fflush(FILE* stream)
+{
+    RT_CHECK("fflush")
+    return REAL(fflush)(stream);
+}
+
+}
+
+// C++ allocation, replaced so that the report points at the plugin code rather than at libstdc++
+
+void* operator new(size_t size)
+{
+    RT_CHECK("operator new")
+    if (void* const ptr = __libc_malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    RT_CHECK("operator new[]")
+    if (void* const ptr = __libc_malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+    {
+        RT_CHECK("operator delete")
+    }
+    __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    if (ptr != nullptr)
+    {
+        RT_CHECK("operator delete[]")
+    }
+    __libc_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    if (ptr != nullptr)
+    {
+        RT_CHECK("operator delete")
+    }
+    __libc_free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    if (ptr != nullptr)
+    {
+        RT_CHECK("operator delete[]")
+    }
+    __libc_free(ptr);
+}
+
+// resolve everything up front, so that the first armed call does not go through dlsym
+static void resolve_interceptors()
+{
+    REAL(pthread_mutex_lock);
+    REAL(pthread_rwlock_rdlock);
+    REAL(pthread_rwlock_wrlock);
+    REAL(pthread_cond_wait);
+    REAL(pthread_cond_timedwait);
+    REAL(sem_wait);
+    REAL(read);
+    REAL(write);
+    REAL(open);
+    REAL(openat);
+    REAL(close);
+    REAL(mmap);
+    REAL(munmap);
+    REAL(nanosleep);
+    REAL(usleep);
+    REAL(sched_yield);
+    REAL(vfprintf);
+    REAL(__vfprintf_chk);
+    REAL(fputs);
+    REAL(puts);
+    REAL(fputc);
+    REAL(fwrite);
+    REAL(fflush);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Options {
+    double sample_rate = 48000;
+    uint32_t max_block_size = 2048;
+    double seconds = 600;
+    uint32_t seed = 1;
+    std::string uri_filter;
+};
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options] bundle...\n"
+                 "  -r, --rate N              sample rate, default 48000\n"
+                 "  -b, --max-block-size N    largest block size, default 2048\n"
+                 "  -s, --seconds N           seconds of audio per plugin, default 600\n"
+                 "  -S, --seed N              random seed, default 1\n"
+                 "  -u, --uri TEXT            only plugins whose URI contains TEXT\n",
+                 argv0);
+}
+
+enum Signal {
+    kSilence,
+    kNoise,
+    kLoudNoise,
+    kDenormals,
+    kImpulses,
+    kNumSignals
+};
+
+static void fill(std::vector<float>& buffer, uint32_t frames, Signal signal, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> noise(-1.f, 1.f);
+
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        switch (signal)
+        {
+        case kSilence:
+            buffer[i] = 0.f;
+            break;
+        case kNoise:
+            buffer[i] = noise(rng);
+            break;
+        case kLoudNoise:
+            buffer[i] = 8.f * noise(rng);
+            break;
+        case kDenormals:
+            buffer[i] = 1e-40f * noise(rng);
+            break;
+        case kImpulses:
+            buffer[i] = rng() % 4096 == 0 ? 1.f : 0.f;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// block sizes as hosts send them: mostly the full block, sometimes odd or very short ones, now and then none
+static uint32_t pick_block_size(uint32_t max_block_size, std::mt19937& rng)
+{
+    switch (rng() % 8)
+    {
+    case 0:
+        return rng() % 64 == 0 ? 0 : 1 + rng() % std::min<uint32_t>(8, max_block_size);
+    case 1:
+    case 2:
+        return 1 + rng() % max_block_size;
+    default:
+        return max_block_size;
+    }
+}
+
+static float pick_value(const lv2host::Port& port, std::mt19937& rng)
+{
+    switch (rng() % 6)
+    {
+    case 0:
+        return port.min;
+    case 1:
+        return port.max;
+    case 2:
+        return port.def;
+    default:
+        const float value = std::uniform_real_distribution<float>(port.min, port.max)(rng);
+        return port.integer ? std::round(value) : value;
+    }
+}
+
+static void print_violations()
+{
+    for (int i = 0; i < g_num_violations; ++i)
+    {
+        const Violation& violation = g_violations[i];
+        Dl_info dlinfo = {};
+
+        if (dladdr(violation.caller, &dlinfo) != 0 && dlinfo.dli_fname != nullptr)
+        {
+            const uintptr_t offset = (uintptr_t)violation.caller - (uintptr_t)dlinfo.dli_fbase;
+
+            std::printf("    %s called %lu times from %s+0x%lx", violation.function, (unsigned long)violation.count,
+                        dlinfo.dli_fname, (unsigned long)offset);
+            if (dlinfo.dli_sname != nullptr)
+                std::printf(" (%s)", dlinfo.dli_sname);
+            std::printf("\n");
+        }
+        else
+        {
+            std::printf("    %s called %lu times from %p\n", violation.function, (unsigned long)violation.count,
+                        violation.caller);
+        }
+    }
+
+    if (g_total_violations != 0 && g_num_violations == kMaxViolations)
+        std::printf("    (only the first %d call sites are listed)\n", kMaxViolations);
+}
+
+static bool check(const Options& opts, const LV2_Descriptor* desc, const lv2host::PluginInfo& info)
+{
+    lv2host::Instance instance(desc, info, opts.sample_rate, opts.max_block_size);
+
+    if (instance.handle == nullptr)
+    {
+        std::printf("FAIL %s: failed to instantiate\n", info.uri.c_str());
+        return false;
+    }
+
+    std::mt19937 rng(opts.seed);
+
+    const uint32_t num_ins = instance.audio_ins.size();
+    const uint32_t num_outs = instance.audio_outs.size();
+    std::vector<std::vector<float>> inputs(num_ins, std::vector<float>(opts.max_block_size, 0.f));
+    std::vector<const float*> ins(num_ins);
+    std::vector<float*> outs(num_outs);
+    for (uint32_t c = 0; c < num_outs; ++c)
+        outs[c] = instance.audio_outs[c].data();
+
+    const uint64_t total_frames = opts.seconds * opts.sample_rate;
+    uint64_t frames = 0;
+    uint64_t blocks = 0;
+    uint64_t restarts = 0;
+    uint64_t next_signal_change = 0;
+    Signal signal = kNoise;
+
+    g_num_violations = 0;
+    g_total_violations = 0;
+
+    instance.activate();
+
+    while (frames < total_frames)
+    {
+        // a host may deactivate and activate again at any time, as when changing the audio device
+        if (rng() % 4096 == 0)
+        {
+            instance.deactivate();
+            instance.activate();
+            ++restarts;
+        }
+
+        if (frames >= next_signal_change)
+        {
+            signal = static_cast<Signal>(rng() % kNumSignals);
+            next_signal_change = frames + rng() % (uint32_t)opts.sample_rate;
+        }
+
+        const uint32_t block_size = pick_block_size(opts.max_block_size, rng);
+
+        for (const lv2host::Port& port : info.ports)
+        {
+            if (! port.audio && port.input && rng() % 8 == 0)
+                instance.controls[port.index] = pick_value(port, rng);
+        }
+
+        // in-place processing in about half of the blocks
+        const bool in_place = rng() % 2 == 0;
+        for (uint32_t c = 0; c < num_ins; ++c)
+        {
+            fill(inputs[c], block_size, signal, rng);
+
+            if (in_place && c < num_outs)
+            {
+                std::copy_n(inputs[c].begin(), block_size, outs[c]);
+                ins[c] = outs[c];
+            }
+            else
+            {
+                ins[c] = inputs[c].data();
+            }
+        }
+
+        t_armed = true;
+        instance.connect_audio(ins.data(), outs.data());
+        instance.run(block_size);
+        t_armed = false;
+
+        frames += block_size;
+        ++blocks;
+    }
+
+    instance.deactivate();
+
+    if (g_total_violations != 0)
+    {
+        std::printf("FAIL %s: %lu calls that are not real-time safe\n", info.uri.c_str(),
+                    (unsigned long)g_total_violations);
+        print_violations();
+        return false;
+    }
+
+    std::printf("PASS %s: %lu blocks, %lu restarts\n", info.uri.c_str(), (unsigned long)blocks,
+                (unsigned long)restarts);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    static const option long_options[] = {
+        { "rate", required_argument, nullptr, 'r' },
+        { "max-block-size", required_argument, nullptr, 'b' },
+        { "seconds", required_argument, nullptr, 's' },
+        { "seed", required_argument, nullptr, 'S' },
+        { "uri", required_argument, nullptr, 'u' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    for (int c; (c = getopt_long(argc, argv, "r:b:s:S:u:h", long_options, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'r':
+            opts.sample_rate = std::strtod(optarg, nullptr);
+            break;
+        case 'b':
+            opts.max_block_size = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 's':
+            opts.seconds = std::strtod(optarg, nullptr);
+            break;
+        case 'S':
+            opts.seed = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 'u':
+            opts.uri_filter = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind == argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opts.max_block_size == 0 || opts.sample_rate <= 0)
+    {
+        std::fprintf(stderr, "invalid block size or sample rate\n");
+        return 1;
+    }
+
+    resolve_interceptors();
+
+    int failures = 0;
+
+    for (int i = optind; i < argc; ++i)
+    {
+        const std::string bundle = argv[i];
+        const lv2host::Library library(bundle);
+        const std::vector<lv2host::PluginInfo> plugins = lv2host::parse_bundle(bundle);
+
+        if (library.descriptor_function == nullptr || plugins.empty())
+        {
+            std::fprintf(stderr, "%s: not a usable bundle\n", bundle.c_str());
+            ++failures;
+            continue;
+        }
+
+        for (const lv2host::PluginInfo& info : plugins)
+        {
+            if (info.uri.find(opts.uri_filter) == std::string::npos)
+                continue;
+
+            const LV2_Descriptor* const desc = library.find(info.uri);
+            if (desc == nullptr)
+            {
+                std::fprintf(stderr, "%s: described in ttl but not in the binary\n", info.uri.c_str());
+                ++failures;
+                continue;
+            }
+
+            if (! check(opts, desc, info))
+                ++failures;
+
+            std::fflush(stdout);
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}